@@ -0,0 +1,104 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+
+/*! Frame completion tracking of the display ranks under contention, as
+    many threads as incoming would run count the tiles of each frame down
+    while the frame waits for them */
+
+#include <display/fb/DisplayFramebuffer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace ospray::dw::display;
+using Clock = std::chrono::high_resolution_clock;
+
+static void benchThreads(const int numThreads, const int numTiles)
+{
+  DisplayFramebuffer::TileGrid grid;
+  grid.tilesRequired.assign((numTiles + 63) / 64, 0);
+  grid.tilesFrame.reset(new std::atomic<int>[numTiles]);
+  for (int t = 0; t < numTiles; t++) {
+    grid.tilesRequired[t >> 6] |= uint64_t(1) << (t & 63);
+    grid.tilesFrame[t] = -1;
+  }
+  grid.numTilesRequired = numTiles;
+
+  FrameCountdown countdown;
+  std::atomic<int> started{0};
+  static constexpr int numFrames = 200;
+
+  // Neighbouring tiles go to different threads, every tile also arrives
+  // a second time like a late duplicate
+  std::vector<std::thread> threads;
+  for (int id = 0; id < numThreads; id++) {
+    threads.emplace_back([&, id] {
+      for (int frame = 1; frame <= numFrames; frame++) {
+        while (started < frame)
+          std::this_thread::yield();
+        for (int t = id; t < numTiles; t += numThreads) {
+          if (grid.arrive(t, frame))
+            countdown.arrive(frame);
+          if (grid.arrive(t, frame))
+            countdown.arrive(frame);
+        }
+      }
+    });
+  }
+
+  const auto start = Clock::now();
+  for (int frame = 1; frame <= numFrames; frame++) {
+    countdown.reset(frame, grid.numTilesRequired);
+    started = frame;
+    countdown.wait();
+  }
+  const double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  for (auto &thread : threads)
+    thread.join();
+
+  std::cout << numThreads << " threads: "
+            << seconds * 1e9 / (double(numFrames) * numTiles)
+            << "ns per tile, " << numFrames / seconds << " frames/s"
+            << std::endl;
+}
+
+int main(int ac, char *av[])
+{
+  // Tiles of a 20x20 wall of 1080p panels with 64 pixel tiles
+  static constexpr int numTiles = 600 * 340;
+  const int maxThreads =
+      std::max(1u, std::thread::hardware_concurrency()) * 2;
+  std::cout << numTiles << " tiles per frame" << std::endl;
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    benchThreads(numThreads, numTiles);
+  return 0;
+}
@@ -0,0 +1,221 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+
+/*! GB/s of the tile and frame kernels of the head node and the display
+    ranks on one core, bytes written per second like the KernelStats of
+    DisplayFramebuffer with DW_MEASURE_TIMES */
+
+#include <display/fb/DisplayFramebuffer.h>
+#include "DisplayFramebuffer_ispc.h"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ospray;
+using namespace ospray::dw::display;
+using Clock = std::chrono::high_resolution_clock;
+
+static void bench(const std::string &name,
+                  const size_t bytes,
+                  const std::function<void()> &kernel)
+{
+  // Warm up the caches, then run for a quarter of a second at least
+  kernel();
+  size_t runs      = 0;
+  const auto start = Clock::now();
+  double seconds   = 0;
+  do {
+    for (int i = 0; i < 16; i++)
+      kernel();
+    runs += 16;
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  } while (seconds < .25);
+  std::cout << std::setw(24) << std::left << name << std::setw(10)
+            << std::right << std::fixed << std::setprecision(2)
+            << bytes * runs / seconds / 1e9 << " GB/s" << std::endl;
+}
+
+int main(int ac, char *av[])
+{
+  static constexpr int tileSize = 256;
+  const vec2i screen(1920, 1080);
+  const int numPixels = screen.x * screen.y;
+
+  std::vector<uint32> tile8(tileSize * tileSize, 0x80604020);
+  std::vector<vec4f> tile32(tileSize * tileSize, vec4f(.25f, .5f, .75f, 1.f));
+  std::vector<uint32> screen8(numPixels, 0x80604020);
+  std::vector<vec4f> screen32(numPixels, vec4f(.25f, .5f, .75f, 1.f));
+  std::vector<float> screenDepth(numPixels, 10.f);
+  std::vector<uint32> out8(numPixels);
+  std::vector<vec4f> out32(numPixels);
+  std::vector<float> outDepth(numPixels);
+
+  // Head node, the part of a tile that lands on a screen with its edge
+  // through the tile, then the display rank copying it into the screen
+  const box2i region(vec2i(56, 0), vec2i(tileSize, 200));
+  const size_t regionPixels = region.size().x * region.size().y;
+  std::vector<byte_t> region8(tileRegionSize<OSP_FB_RGBA8>(region));
+  std::vector<byte_t> region32(tileRegionSize<OSP_FB_RGBA32F>(region));
+  TilePixels<OSP_FB_RGBA8> pixels8(vec2i(0), (byte_t *)tile8.data(), tileSize);
+  TilePixels<OSP_FB_RGBA32F> pixels32(
+      vec2i(0), (byte_t *)tile32.data(), tileSize);
+  bench("crop RGBA8", regionPixels * sizeof(uint32), [&] {
+    writeTileRegion(pixels8, region, 1, 1, region8.data());
+  });
+  bench("crop RGBA32F", regionPixels * sizeof(vec4f), [&] {
+    writeTileRegion(pixels32, region, 1, 1, region32.data());
+  });
+  bench("blit RGBA8", regionPixels * sizeof(uint32), [&] {
+    blitRegion<OSP_FB_RGBA8>((TileRegion *)region8.data(),
+                             (byte_t *)out8.data(),
+                             vec2i(0),
+                             screen.x);
+  });
+  bench("blit RGBA32F", regionPixels * sizeof(vec4f), [&] {
+    blitRegion<OSP_FB_RGBA32F>((TileRegion *)region32.data(),
+                               (byte_t *)out32.data(),
+                               vec2i(0),
+                               screen.x);
+  });
+
+  // Head node preview of a wall four times the size of its window
+  const vec2f ratio(.25f);
+  const size_t previewPixels = tileSize * tileSize * ratio.x * ratio.y;
+  bench("downsample RGBA8", previewPixels * sizeof(uint32), [&] {
+    ispc::DisplayFramebuffer_downsampleRGBA8(tile8.data(),
+                                             0,
+                                             0,
+                                             tileSize,
+                                             ratio.x,
+                                             ratio.y,
+                                             out8.data(),
+                                             screen.x,
+                                             screen.y);
+  });
+  bench("downsample RGBA32F", previewPixels * sizeof(vec4f), [&] {
+    ispc::DisplayFramebuffer_downsampleRGBA32F((const float *)tile32.data(),
+                                               0,
+                                               0,
+                                               tileSize,
+                                               ratio.x,
+                                               ratio.y,
+                                               (float *)out32.data(),
+                                               screen.x,
+                                               screen.y);
+  });
+
+  bench("convert RGBA32F", numPixels * sizeof(uint32), [&] {
+    ispc::DisplayFramebuffer_convertRGBA32FToRGBA8(
+        (const float *)screen32.data(), out8.data(), numPixels, false);
+  });
+  bench("convert RGBA32F sRGB", numPixels * sizeof(uint32), [&] {
+    ispc::DisplayFramebuffer_convertRGBA32FToRGBA8(
+        (const float *)screen32.data(), out8.data(), numPixels, true);
+  });
+
+  // Display rank of a wall rendered at half scale, its screen is the wall
+  const box2i footprint = dw::scaledFootprint(vec2i(0), screen, screen, 2);
+  bench("upscale RGBA8", numPixels * sizeof(uint32), [&] {
+    ispc::DisplayFramebuffer_upscaleRGBA8(screen8.data(),
+                                          footprint.lower.x,
+                                          footprint.lower.y,
+                                          footprint.size().x,
+                                          footprint.size().y,
+                                          2,
+                                          out8.data(),
+                                          0,
+                                          0,
+                                          screen.x,
+                                          0,
+                                          screen.y);
+  });
+  bench("upscale RGBA32F", numPixels * sizeof(vec4f), [&] {
+    ispc::DisplayFramebuffer_upscaleRGBA32F((const float *)screen32.data(),
+                                            footprint.lower.x,
+                                            footprint.lower.y,
+                                            footprint.size().x,
+                                            footprint.size().y,
+                                            2,
+                                            (float *)out32.data(),
+                                            0,
+                                            0,
+                                            screen.x,
+                                            0,
+                                            screen.y);
+  });
+
+  // The camera moved sideways between the two frames
+  FrameCamera last, next;
+  next.pos = vec3f(.1f, 0.f, 0.f);
+  last.aspect = next.aspect = float(screen.x) / screen.y;
+  float from[12], to[12];
+  last.basis(from);
+  next.basis(to);
+  bench("reproject RGBA8",
+        numPixels * (sizeof(uint32) + sizeof(float)),
+        [&] {
+          ispc::DisplayFramebuffer_reprojectRGBA8(screen8.data(),
+                                                  screenDepth.data(),
+                                                  out8.data(),
+                                                  outDepth.data(),
+                                                  screen.x,
+                                                  screen.y,
+                                                  0,
+                                                  0,
+                                                  screen.x,
+                                                  screen.y,
+                                                  from,
+                                                  to,
+                                                  0,
+                                                  screen.y);
+        });
+  bench("reproject RGBA32F",
+        numPixels * (sizeof(vec4f) + sizeof(float)),
+        [&] {
+          ispc::DisplayFramebuffer_reprojectRGBA32F(
+              (const float *)screen32.data(),
+              screenDepth.data(),
+              (float *)out32.data(),
+              outDepth.data(),
+              screen.x,
+              screen.y,
+              0,
+              0,
+              screen.x,
+              screen.y,
+              from,
+              to,
+              0,
+              screen.y);
+        });
+  return 0;
+}
@@ -0,0 +1,96 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+
+/*! Build and lookup times of the tile to rank routing table of the head
+    node, on synthetic walls of up to a few hundred panels */
+
+#include <display/glDisplay/WallConfig.h>
+#include "ospcommon/tasking/tasking_system_handle.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace ospray::dw;
+using Clock = std::chrono::high_resolution_clock;
+
+static double elapsedMicroseconds(const Clock::time_point &start)
+{
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+      .count();
+}
+
+static void benchWall(const vec2i &panels)
+{
+  WallLayout layout;
+  layout.displayConfig      = panels;
+  layout.basel_compensation = vec2i(40, 40);
+  layout.localScreen        = vec2i(1920, 1080);
+  layout.orientation        = 0;
+
+  // The constructor builds the tables of every scale
+  static constexpr int numBuilds = 5;
+  double build                   = 0;
+  for (int i = 0; i < numBuilds; i++) {
+    const auto start = Clock::now();
+    wallconfig wall(layout);
+    build += elapsedMicroseconds(start);
+  }
+
+  wallconfig wall(layout);
+  static constexpr int numRounds = 20;
+  size_t lookups = 0, routes = 0;
+  const auto start = Clock::now();
+  for (int round = 0; round < numRounds; round++) {
+    for (int scale = 1; scale < (1 << numScaleLevels); scale <<= 1) {
+      const vec2i wallSize = divRoundUp(wall.completeScreeen, vec2i(scale));
+      for (int y = 0; y < wallSize.y; y += wall.tileSize)
+        for (int x = 0; x < wallSize.x; x += wall.tileSize) {
+          routes += wall.getRoutes(vec2i(x, y), scale).size();
+          lookups++;
+        }
+    }
+  }
+  const double lookup = elapsedMicroseconds(start);
+
+  std::cout << panels.x << "x" << panels.y << " panels, "
+            << wall.completeScreeen << " pixels, " << wall.maxTiles.x
+            << "x" << wall.maxTiles.y << " tiles: build "
+            << build / numBuilds << "us, lookup "
+            << lookup * 1000.0 / lookups << "ns ("
+            << routes / double(lookups) << " routes per tile)" << std::endl;
+}
+
+int main(int ac, char *av[])
+{
+  ospcommon::tasking::initTaskingSystem();
+  std::cout << "Tile size " << TILE_SIZE << std::endl;
+  for (const vec2i panels :
+       {vec2i(4, 4), vec2i(10, 10), vec2i(16, 8), vec2i(20, 20)})
+    benchWall(panels);
+  return 0;
+}
@@ -0,0 +1,289 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#include "BufferPool.h"
+#include "ospcommon/utility/getEnvVar.h"
+
+#include <array>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace mpicommon {
+
+  namespace {
+
+    // Sizes are rounded up to a power of two so buffers of similar size
+    // share a free list
+    constexpr size_t minBufferSize = 4096;
+    constexpr int numClasses       = 20;
+    // Slabs match the huge page size, larger classes get a slab per buffer
+    constexpr size_t slabSize = 2 * 1024 * 1024;
+    // Each thread keeps about this many idle bytes per class, and moves
+    // half of its list to the shared one once it is over
+    constexpr size_t threadCacheBytes = 1024 * 1024;
+
+    using FreeLists = std::array<std::vector<byte_t *>, numClasses>;
+
+    int sizeClass(size_t size)
+    {
+      int c = 0;
+      while ((minBufferSize << c) < size)
+        c++;
+      if (c >= numClasses)
+        throw std::runtime_error("Buffer of " + std::to_string(size) +
+                                 " bytes is larger than the pool supports");
+      return c;
+    }
+
+    size_t classSize(int c)
+    {
+      return minBufferSize << c;
+    }
+
+    size_t threadCacheLimit(int c)
+    {
+      return std::max<size_t>(2, threadCacheBytes / classSize(c));
+    }
+
+    struct SharedPool
+    {
+      std::mutex mutex;
+      FreeLists free;
+      bool hugePages;
+      size_t maxBytes;
+
+      SharedPool()
+      {
+        hugePages =
+            ospcommon::utility::getEnvVar<int>("DW_POOL_HUGE_PAGES")
+                .value_or(0);
+        maxBytes = size_t(ospcommon::utility::getEnvVar<int>("DW_POOL_MAX_MB")
+                              .value_or(0)) *
+                   1024 * 1024;
+      }
+
+      /*! moves up to count buffers of class c into list, carving a new
+          slab if there are none left. Returns false past DW_POOL_MAX_MB */
+      bool take(int c, std::vector<byte_t *> &list, size_t count)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (moveTo(c, list, count))
+            return true;
+        }
+        // Mapping and faulting in a slab takes a while, the other threads
+        // keep using the shared lists meanwhile
+        size_t length;
+        byte_t *slab = newSlab(c, length);
+        if (!slab)
+          return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const size_t size = classSize(c);
+        for (size_t offset = 0; offset + size <= length; offset += size)
+          free[c].push_back(slab + offset);
+        return moveTo(c, list, count);
+      }
+
+      void put(int c, byte_t *const *buffers, size_t count)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        free[c].insert(free[c].end(), buffers, buffers + count);
+      }
+
+     private:
+      bool moveTo(int c, std::vector<byte_t *> &list, size_t count)
+      {
+        auto &shared = free[c];
+        if (shared.empty())
+          return false;
+        count = std::min(count, shared.size());
+        list.insert(list.end(), shared.end() - count, shared.end());
+        shared.resize(shared.size() - count);
+        poolStats().sharedHits++;
+        return true;
+      }
+
+      /*! slab for class c, nullptr past DW_POOL_MAX_MB */
+      byte_t *newSlab(int c, size_t &length)
+      {
+        const size_t size = classSize(c);
+        length            = (size + slabSize - 1) / slabSize * slabSize;
+        auto &stats       = poolStats();
+        // Reserved before mapping, threads carving at once stay under it
+        const size_t total = stats.slabBytes.fetch_add(length) + length;
+        if (maxBytes && total > maxBytes) {
+          stats.slabBytes -= length;
+          return nullptr;
+        }
+        stats.slabs++;
+        return mapSlab(length);
+      }
+
+      byte_t *mapSlab(size_t length)
+      {
+        void *slab = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        // Only succeeds if the node has huge pages reserved
+        if (hugePages) {
+          slab = mmap(nullptr,
+                      length,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                      -1,
+                      0);
+        }
+#endif
+        if (slab == MAP_FAILED) {
+          slab = mmap(nullptr,
+                      length,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+          if (slab == MAP_FAILED)
+            throw std::runtime_error("Could not map a buffer pool slab");
+#ifdef MADV_HUGEPAGE
+          if (hugePages)
+            madvise(slab, length, MADV_HUGEPAGE);
+#endif
+        }
+        // Fault the pages in now rather than on the first tile, the
+        // first touch also places them on the calling thread NUMA node
+        std::memset(slab, 0, length);
+        return (byte_t *)slab;
+      }
+    };
+
+    // Never destroyed, buffers may outlive static destruction
+    SharedPool &sharedPool()
+    {
+      static SharedPool *instance = new SharedPool;
+      return *instance;
+    }
+
+    struct ThreadCache
+    {
+      FreeLists free;
+
+      ThreadCache();
+      ~ThreadCache();
+
+      byte_t *get(int c)
+      {
+        auto &list = free[c];
+        if (!list.empty()) {
+          poolStats().threadHits++;
+        } else if (!sharedPool().take(c, list, threadCacheLimit(c) / 2 + 1)) {
+          return nullptr;
+        }
+        byte_t *buffer = list.back();
+        list.pop_back();
+        return buffer;
+      }
+
+      void put(int c, byte_t *buffer)
+      {
+        auto &list = free[c];
+        list.push_back(buffer);
+        if (list.size() > threadCacheLimit(c)) {
+          const size_t half = list.size() / 2;
+          sharedPool().put(c, list.data() + list.size() - half, half);
+          list.resize(list.size() - half);
+        }
+      }
+    };
+
+    // Buffers released by thread_locals destroyed after the cache go
+    // straight to the shared lists
+    enum CacheState
+    {
+      CACHE_UNUSED,
+      CACHE_ALIVE,
+      CACHE_DESTROYED
+    };
+    thread_local CacheState threadCacheState = CACHE_UNUSED;
+    thread_local ThreadCache threadCache;
+
+    ThreadCache::ThreadCache()
+    {
+      threadCacheState = CACHE_ALIVE;
+    }
+
+    ThreadCache::~ThreadCache()
+    {
+      threadCacheState = CACHE_DESTROYED;
+      for (int c = 0; c < numClasses; c++)
+        sharedPool().put(c, free[c].data(), free[c].size());
+    }
+
+  }  // namespace
+
+  std::shared_ptr<byte_t> allocateBuffer(size_t size)
+  {
+    const int c          = sizeClass(size);
+    const size_t rounded = classSize(c);
+    auto &stats          = poolStats();
+    stats.allocations++;
+    stats.bytesInUse += rounded;
+
+    byte_t *buffer = threadCache.get(c);
+    if (!buffer) {
+      stats.overflows++;
+      return std::shared_ptr<byte_t>((byte_t *)malloc(rounded),
+                                     [rounded](byte_t *buffer) {
+                                       poolStats().bytesInUse -= rounded;
+                                       ::free(buffer);
+                                     });
+    }
+
+    return std::shared_ptr<byte_t>(buffer, [c](byte_t *buffer) {
+      poolStats().bytesInUse -= classSize(c);
+      if (threadCacheState != CACHE_DESTROYED)
+        threadCache.put(c, buffer);
+      else
+        sharedPool().put(c, &buffer, 1);
+    });
+  }
+
+  PoolStats &poolStats()
+  {
+    static PoolStats stats;
+    return stats;
+  }
+
+  CopyStats &copyStats()
+  {
+    static CopyStats stats;
+    return stats;
+  }
+
+}  // namespace mpicommon
@@ -0,0 +1,87 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#pragma once
+
+#include "MPICommon.h"
+
+#include <atomic>
+#include <memory>
+
+namespace mpicommon {
+
+  /*! refcounted byte buffer, it goes back to the pool once the last
+      reference is gone. Buffers are carved out of slabs per power of two
+      size class and cached per thread, see DW_POOL_HUGE_PAGES and
+      DW_POOL_MAX_MB */
+  std::shared_ptr<byte_t> allocateBuffer(size_t size);
+
+  /*! where buffers came from since the last reset, the slab totals are
+      never reset */
+  struct PoolStats
+  {
+    std::atomic<uint64_t> allocations{0};
+    // Served by the calling thread cache, without taking a lock
+    std::atomic<uint64_t> threadHits{0};
+    // Served by the shared free lists
+    std::atomic<uint64_t> sharedHits{0};
+    // Past DW_POOL_MAX_MB, malloc'd and freed on release
+    std::atomic<uint64_t> overflows{0};
+    std::atomic<uint64_t> slabs{0};
+    std::atomic<uint64_t> slabBytes{0};
+    std::atomic<uint64_t> bytesInUse{0};
+
+    void reset()
+    {
+      allocations = threadHits = sharedHits = overflows = 0;
+    }
+  };
+
+  PoolStats &poolStats();
+
+  /*! memcpys still done on a tile's way through a node and the bytes they
+      moved, reported per frame */
+  struct CopyStats
+  {
+    std::atomic<uint64_t> copies{0};
+    std::atomic<uint64_t> bytes{0};
+
+    void count(size_t size)
+    {
+      copies++;
+      bytes += size;
+    }
+
+    void reset()
+    {
+      copies = bytes = 0;
+    }
+  };
+
+  CopyStats &copyStats();
+
+}  // namespace mpicommon
@@ -0,0 +1,176 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+
+#include "Compression.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(DW_USE_SNAPPY)
+#include <snappy.h>
+#elif defined(DW_USE_DENSITY)
+#include <density_api.h>
+#endif
+
+namespace mpicommon {
+
+  Codec defaultCodec()
+  {
+#if defined(DW_USE_SNAPPY)
+    return CODEC_SNAPPY;
+#elif defined(DW_USE_DENSITY)
+    return CODEC_DENSITY;
+#else
+    return CODEC_NONE;
+#endif
+  }
+
+  size_t maxCompressedSize(Codec codec, size_t size)
+  {
+    switch (codec) {
+#if defined(DW_USE_SNAPPY)
+    case CODEC_SNAPPY:
+      return snappy::MaxCompressedLength(size);
+#elif defined(DW_USE_DENSITY)
+    case CODEC_DENSITY:
+      return density_compress_safe_size(size);
+#endif
+    case CODEC_NONE:
+      return size;
+    default:
+      throw std::runtime_error("Codec not available in this build");
+    }
+  }
+
+  size_t maxUncompressedSize(Codec codec, size_t size)
+  {
+    switch (codec) {
+#if defined(DW_USE_DENSITY)
+    case CODEC_DENSITY:
+      return density_decompress_safe_size(size);
+#endif
+    default:
+      return size;
+    }
+  }
+
+  size_t compress(Codec codec,
+                  const byte_t *src,
+                  size_t size,
+                  byte_t *dst,
+                  size_t capacity)
+  {
+    switch (codec) {
+#if defined(DW_USE_SNAPPY)
+    case CODEC_SNAPPY: {
+      size_t compressed_size;
+      snappy::RawCompress((char *)src, size, (char *)dst, &compressed_size);
+      return compressed_size;
+    }
+#elif defined(DW_USE_DENSITY)
+    case CODEC_DENSITY: {
+      density_processing_result result = density_compress(
+          src, size, dst, capacity, DENSITY_ALGORITHM_CHEETAH);
+      if (result.state != DENSITY_STATE_OK) {
+        printf("[Compression] Compression %llu bytes to %llu bytes\n",
+               result.bytesRead,
+               result.bytesWritten);
+        throw std::runtime_error("Error compressing data");
+      }
+      return result.bytesWritten;
+    }
+#endif
+    case CODEC_NONE:
+      std::memcpy(dst, src, size);
+      return size;
+    default:
+      throw std::runtime_error("Codec not available in this build");
+    }
+  }
+
+  size_t uncompress(Codec codec,
+                    const byte_t *src,
+                    size_t size,
+                    byte_t *dst,
+                    size_t capacity)
+  {
+    switch (codec) {
+#if defined(DW_USE_SNAPPY)
+    case CODEC_SNAPPY: {
+      size_t uncompressed_size;
+      snappy::GetUncompressedLength((char *)src, size, &uncompressed_size);
+      if (uncompressed_size > capacity ||
+          !snappy::RawUncompress((char *)src, size, (char *)dst))
+        throw std::runtime_error("Error uncompressing data");
+      return uncompressed_size;
+    }
+#elif defined(DW_USE_DENSITY)
+    case CODEC_DENSITY: {
+      density_processing_result result =
+          density_decompress(src, size, dst, capacity);
+      if (result.state != DENSITY_STATE_OK) {
+        printf("[Decompression] Decompression %llu bytes to %llu bytes %i\n",
+               result.bytesRead,
+               result.bytesWritten,
+               result.state);
+        throw std::runtime_error("Error uncompressing data");
+      }
+      return result.bytesWritten;
+    }
+#endif
+    case CODEC_NONE:
+      std::memcpy(dst, src, size);
+      return size;
+    default:
+      throw std::runtime_error("Codec not available in this build");
+    }
+  }
+
+  void shuffle(const byte_t *src, byte_t *dst, size_t size, size_t typesize)
+  {
+    const size_t n = size / typesize;
+    for (size_t k = 0; k < typesize; k++) {
+      byte_t *plane = dst + k * n;
+      for (size_t i = 0; i < n; i++)
+        plane[i] = src[i * typesize + k];
+    }
+    std::memcpy(dst + n * typesize, src + n * typesize, size - n * typesize);
+  }
+
+  void unshuffle(const byte_t *src, byte_t *dst, size_t size, size_t typesize)
+  {
+    const size_t n = size / typesize;
+    for (size_t k = 0; k < typesize; k++) {
+      const byte_t *plane = src + k * n;
+      for (size_t i = 0; i < n; i++)
+        dst[i * typesize + k] = plane[i];
+    }
+    std::memcpy(dst + n * typesize, src + n * typesize, size - n * typesize);
+  }
+
+}  // namespace mpicommon
@@ -0,0 +1,68 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#pragma once
+
+#include "MPICommon.h"
+
+namespace mpicommon {
+
+  enum Codec : uint32_t
+  {
+    CODEC_NONE    = 0,
+    CODEC_SNAPPY  = 1,
+    CODEC_DENSITY = 2
+  };
+
+  /*! codec selected at build time (DW_USE_SNAPPY / DW_USE_DENSITY) */
+  Codec defaultCodec();
+
+  size_t maxCompressedSize(Codec codec, size_t size);
+
+  /*! some codecs write past the uncompressed size while decoding */
+  size_t maxUncompressedSize(Codec codec, size_t size);
+
+  /*! returns the number of bytes written to dst */
+  size_t compress(Codec codec,
+                  const byte_t *src,
+                  size_t size,
+                  byte_t *dst,
+                  size_t capacity);
+
+  /*! returns the number of bytes written to dst */
+  size_t uncompress(Codec codec,
+                    const byte_t *src,
+                    size_t size,
+                    byte_t *dst,
+                    size_t capacity);
+
+  /*! byte planes prefilter, byte k of every typesize element goes to plane
+      k. Pixels compress much better this way */
+  void shuffle(const byte_t *src, byte_t *dst, size_t size, size_t typesize);
+  void unshuffle(const byte_t *src, byte_t *dst, size_t size, size_t typesize);
+
+}  // namespace mpicommon
@@ -0,0 +1,84 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#include "SharedReadStream.h"
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace mpicommon {
+
+  SharedReadStream::SharedReadStream(TCPFabric &fabric) : fabric(fabric) {}
+
+  void SharedReadStream::nextBlock()
+  {
+    block  = fabric.readShared(blockSize);
+    offset = 0;
+  }
+
+  void SharedReadStream::push(std::shared_ptr<byte_t> block, size_t size)
+  {
+    assert(offset == blockSize);
+    this->block = std::move(block);
+    blockSize   = size;
+    offset      = 0;
+  }
+
+  void SharedReadStream::read(void *mem, size_t size)
+  {
+    byte_t *out = (byte_t *)mem;
+    while (size) {
+      if (offset == blockSize)
+        nextBlock();
+      const size_t count = std::min(size, blockSize - offset);
+      std::memcpy(out, block.get() + offset, count);
+      offset += count;
+      out += count;
+      size -= count;
+    }
+  }
+
+  std::shared_ptr<byte_t> SharedReadStream::view(size_t size)
+  {
+    if (offset == blockSize)
+      nextBlock();
+    if (blockSize - offset >= size) {
+      // Aliases the block, it lives as long as any view into it
+      std::shared_ptr<byte_t> data(block, block.get() + offset);
+      offset += size;
+      return data;
+    }
+
+    auto data = allocateBuffer(size);
+    read(data.get(), size);
+    copyStats().count(size);
+    return data;
+  }
+
+}  // namespace mpicommon
@@ -0,0 +1,61 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#pragma once
+
+#include "TCPFabric.h"
+
+#include <memory>
+
+namespace mpicommon {
+
+  /*! Read stream over a TCPFabric that keeps the blocks it reads. Bulk
+      payloads are handed out as refcounted views into the block the
+      socket was read into, instead of being copied out of it */
+  struct SharedReadStream : public networking::ReadStream
+  {
+    SharedReadStream(TCPFabric &fabric);
+
+    void read(void *mem, size_t size) override;
+
+    /*! continue from a block the caller read from the fabric, the
+        previous one has to be used up */
+    void push(std::shared_ptr<byte_t> block, size_t size);
+
+    /*! next size bytes, copied only when they straddle two blocks */
+    std::shared_ptr<byte_t> view(size_t size);
+
+   private:
+    void nextBlock();
+
+    TCPFabric &fabric;
+    std::shared_ptr<byte_t> block;
+    size_t blockSize{0};
+    size_t offset{0};
+  };
+
+}  // namespace mpicommon
@@ -28,19 +28,14 @@
 
 #include "TCPFabric.h"
 #include <chrono>
+#include <stdexcept>
 
-#if defined(DW_USE_SNAPPY)
-#include <snappy.h>
-#elif defined(DW_USE_DENSITY)
-#include <density_api.h>
+#ifdef DENSITY_MEASURE_TIMES
 #include "OSPConfig.h"
-constexpr uint_fast64_t lion_packet_size = TILE_SIZE * TILE_SIZE * 4;
+constexpr size_t lion_packet_size = TILE_SIZE * TILE_SIZE * 4;
 
 static uint64_t rcount = 0;
 static uint64_t scount = 0;
-
-#else
-
 #endif
 
 namespace mpicommon {
@@ -56,226 +51,171 @@ namespace mpicommon {
     }
   }
 
+  TCPFabric::TCPFabric(ospcommon::socket_t bound, int port)
+      : port(port), server(true)
+  {
+    connection = ospcommon::listen(bound);
+    ospcommon::close(bound);
+  }
+
   TCPFabric::~TCPFabric()
   {
     ospcommon::close(connection);
   }
-#if defined(DW_USE_SNAPPY)
 
   size_t TCPFabric::read(void *&mem)
   {
-    uint32_t sz32 = 0;
-    // Get the size of the bcast being sent to us. Only this part must be
-    // non-blocking, after getting the size we know everyone will enter the
-    // blocking barrier and the blocking bcast where the buffer is sent out.
-    ospcommon::read(connection, &sz32, sizeof(uint32_t));
-    // TODO: Maybe at some point we should dump the buffer if it gets really
-    // large
-    char *compressed_data_block = new char[sz32];
-    ospcommon::read(connection, compressed_data_block, sz32);
-    size_t compressed_data_size;
-    snappy::GetUncompressedLength(
-        compressed_data_block, sz32, &compressed_data_size);
-    buffer.resize(compressed_data_size);
-    mem = buffer.data();
-    snappy::RawUncompress(compressed_data_block, sz32, (char *)mem);
-    delete[] compressed_data_block;
-    return compressed_data_size;
+    size_t size;
+    current = readShared(size);
+    mem     = current.get();
+    return size;
   }
 
-  void TCPFabric::send(void *mem, size_t size)
+  std::shared_ptr<byte_t> TCPFabric::readShared(size_t &size)
   {
-    assert(size < (1LL << 30));
-    uint32_t sz32               = size;
-    char *compressed_data_block = new char[snappy::MaxCompressedLength(sz32)];
-    size_t compressed_data_size;
-    snappy::RawCompress(
-        (char *)mem, sz32, compressed_data_block, &compressed_data_size);
-    // Send the size of the bcast we're sending. Only this part must be
-    // non-blocking, after getting the size we know everyone will enter the
-    // blocking barrier and the blocking bcast where the buffer is sent out.
-    ospcommon::write(connection, &compressed_data_size, sizeof(uint32_t));
-    // Now do non-blocking test to see when this bcast is satisfied to avoid
-    // locking out the send/recv threads
-    ospcommon::write(connection, compressed_data_block, compressed_data_size);
-    ospcommon::flush(connection);
-
-    delete[] compressed_data_block;
+    FrameKind kind;
+    auto block = readShared(size, kind);
+    if (kind != FRAME_WORK)
+      throw std::runtime_error("Got a tile frame on the work stream");
+    return block;
   }
-#elif defined(DW_USE_DENSITY)
-  size_t TCPFabric::read(void *&mem)
+
+  std::shared_ptr<byte_t> TCPFabric::readShared(size_t &size, FrameKind &kind)
   {
-    uint_fast64_t sz32          = 0, size_flag;
-    uint_fast64_t compress_size = 0;
-    //  // Get the size of the bcast being sent to us. Only this part must be
-    //  // non-blocking, after getting the size we know everyone will enter the
-    //  // blocking barrier and the blocking bcast where the buffer is sent out.
-    //  ospcommon::read(connection, &sz32, sizeof(uint32_t));
-    //  // TODO: Maybe at some point we should dump the buffer if it gets really
-    //  // large
-    //  buffer.resize(sz32);
-    //  mem = buffer.data();
-    //  ospcommon::read(connection, mem, sz32);
 #ifdef DENSITY_MEASURE_TIMES
-    std::chrono::high_resolution_clock::time_point tstart_read =
-        std::chrono::high_resolution_clock::now();
+    auto tstart_read = std::chrono::high_resolution_clock::now();
 #endif
+    // Every message carries its own codec, the sender may forward payloads
+    // that were compressed somewhere else
+    FrameHeader header;
+    ospcommon::read(connection, &header, sizeof(FrameHeader));
+    kind = FrameKind(header.kind);
+
+    if (header.codec == CODEC_NONE) {
+      auto block = allocateBuffer(header.rawSize);
+      ospcommon::read(connection, block.get(), header.rawSize);
+      size = header.rawSize;
+      return block;
+    }
 
-    ospcommon::read(connection, &sz32, sizeof(uint_fast64_t));
-    ospcommon::read(connection, &compress_size, sizeof(uint_fast64_t));
-    byte_t *outCompressed = new byte_t[compress_size];
-    ospcommon::read(connection, outCompressed, compress_size);
+    scratch.resize(header.wireSize);
+    ospcommon::read(connection, scratch.data(), header.wireSize);
 
 #ifdef DENSITY_MEASURE_TIMES
-    std::chrono::high_resolution_clock::time_point tfinish_read =
-        std::chrono::high_resolution_clock::now();
+    auto tfinish_read = std::chrono::high_resolution_clock::now();
 #endif
 
-    uint_fast64_t decompress_safe_size = density_decompress_safe_size(sz32);
-    buffer.resize(decompress_safe_size);
-    mem = buffer.data();
-
-    density_processing_result result;
-    result = density_decompress(
-        outCompressed, compress_size, (uint8_t *)mem, decompress_safe_size);
-
-    if (result.state != DENSITY_STATE_OK) {
-      printf("[Decompression] Decompression %llu bytes to %llu bytes %i\n",
-             result.bytesRead,
-             result.bytesWritten,
-             result.state);
-      throw std::runtime_error("Error uncompressing data");
-    }
+    auto block = allocateBuffer(
+        maxUncompressedSize(Codec(header.codec), header.rawSize));
+    size = uncompress(Codec(header.codec),
+                      scratch.data(),
+                      header.wireSize,
+                      block.get(),
+                      maxUncompressedSize(Codec(header.codec), header.rawSize));
+    copyStats().count(size);
 
 #ifdef DENSITY_MEASURE_TIMES
-    if (decompress_safe_size >= lion_packet_size) {
-      std::chrono::high_resolution_clock::time_point tfinish_compression =
-        std::chrono::high_resolution_clock::now();
-
+    if (size >= lion_packet_size) {
+      auto tfinish_compression = std::chrono::high_resolution_clock::now();
       auto decompression_time =
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-          tfinish_compression - tfinish_read)
-          .count();
-      auto decompression_time_seconds =
-        std::chrono::duration_cast<std::chrono::seconds>(tfinish_compression -
-          tfinish_read)
-          .count();
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              tfinish_compression - tfinish_read)
+              .count();
       auto read_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-        tfinish_read - tstart_read)
-        .count();
-      auto read_time_seconds = std::chrono::duration_cast<std::chrono::seconds>(
-        tfinish_read - tstart_read)
-        .count();
+                           tfinish_read - tstart_read)
+                           .count();
       std::cout << "[ " << rcount++ << " ] Decompressiom ratio : "
-                << (float(result.bytesWritten) / compress_size) << " "
-                << result.bytesWritten << " /  " << compress_size << " ";
-      std::cout << "Time decompression : " << decompression_time << "ms ("
-                << decompression_time_seconds << "s) send: " << read_time
-                << "ms (" << read_time_seconds << "s)" << std::endl;
+                << (float(size) / header.wireSize) << " " << size << " /  "
+                << header.wireSize << " ";
+      std::cout << "Time decompression : " << decompression_time
+                << "ms read: " << read_time << "ms" << std::endl;
     }
 #endif
+    return block;
+  }
 
-    delete[] outCompressed;
-    return result.bytesWritten;
+  void TCPFabric::sendTile(const TileFrame &tile, const void *payload)
+  {
+    FrameHeader header;
+    header.rawSize  = sizeof(TileFrame) + tile.size;
+    header.wireSize = header.rawSize;
+    header.codec    = CODEC_NONE;
+    header.kind     = FRAME_TILE;
+    ospcommon::write(connection, &header, sizeof(FrameHeader));
+    ospcommon::write(connection, &tile, sizeof(TileFrame));
+    if (tile.size)
+      ospcommon::write(connection, payload, tile.size);
+    ospcommon::flush(connection);
+
+    tileStats.tiles++;
+    tileStats.framingBytes += sizeof(FrameHeader) + sizeof(TileFrame);
+    tileStats.payloadBytes += tile.size;
+  }
+
+  void TCPFabric::sendAck(uint64_t seq)
+  {
+    sendFrame(FRAME_ACK, &seq, sizeof(seq));
+  }
+
+  void TCPFabric::sendFrame(FrameKind kind, const void *mem, size_t size)
+  {
+    FrameHeader header;
+    header.rawSize  = size;
+    header.wireSize = size;
+    header.codec    = CODEC_NONE;
+    header.kind     = kind;
+    ospcommon::write(connection, &header, sizeof(FrameHeader));
+    ospcommon::write(connection, mem, size);
+    ospcommon::flush(connection);
   }
 
   void TCPFabric::send(void *mem, size_t size)
   {
     assert(size < (1LL << 30));
-    uint_fast64_t sz32               = size;
-    uint_fast64_t compress_safe_size = density_compress_safe_size(sz32);
-
-    DENSITY_ALGORITHM compression = DENSITY_ALGORITHM_CHEETAH;
-//    if (compress_safe_size >= lion_packet_size) {
-//      compression = DENSITY_ALGORITHM_CHAMELEON;
-//    }
+    FrameHeader header;
+    header.rawSize = size;
+    header.codec   = codec;
+
+    if (codec == CODEC_NONE) {
+      header.wireSize = size;
+      ospcommon::write(connection, &header, sizeof(FrameHeader));
+      ospcommon::write(connection, mem, size);
+      ospcommon::flush(connection);
+      return;
+    }
 
 #ifdef DENSITY_MEASURE_TIMES
-    std::chrono::high_resolution_clock::time_point tstart_compression =
-        std::chrono::high_resolution_clock::now();
+    auto tstart_compression = std::chrono::high_resolution_clock::now();
 #endif
 
-    byte_t *outCompressed = new byte_t[compress_safe_size];
-    density_processing_result result;
-    result = density_compress(
-        (uint8_t *)mem, sz32, outCompressed, compress_safe_size, compression);
-
-    if (result.state != DENSITY_STATE_OK) {
-      printf("[Compression] Compression %llu bytes to %llu bytes\n",
-             result.bytesRead,
-             result.bytesWritten);
-      delete[] outCompressed;
-      throw std::runtime_error("Error compressing data");
-    }
+    scratch.resize(maxCompressedSize(codec, size));
+    header.wireSize = compress(
+        codec, (byte_t *)mem, size, scratch.data(), scratch.size());
 
 #ifdef DENSITY_MEASURE_TIMES
-    std::chrono::high_resolution_clock::time_point tfinish_compression =
-        std::chrono::high_resolution_clock::now();
+    auto tfinish_compression = std::chrono::high_resolution_clock::now();
 #endif
 
-    ospcommon::write(connection, &sz32, sizeof(uint_fast64_t));
-    ospcommon::write(connection, &result.bytesWritten, sizeof(uint_fast64_t));
-    ospcommon::write(connection, outCompressed, result.bytesWritten);
+    ospcommon::write(connection, &header, sizeof(FrameHeader));
+    ospcommon::write(connection, scratch.data(), header.wireSize);
     ospcommon::flush(connection);
 
 #ifdef DENSITY_MEASURE_TIMES
-    if (compress_safe_size >= lion_packet_size) {
-      std::chrono::high_resolution_clock::time_point tfinish_send =
-        std::chrono::high_resolution_clock::now();
-
+    if (size >= lion_packet_size) {
+      auto tfinish_send = std::chrono::high_resolution_clock::now();
       auto compression_time =
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-          tfinish_compression - tstart_compression)
-          .count();
-      auto compression_time_seconds =
-        std::chrono::duration_cast<std::chrono::seconds>(tfinish_compression -
-          tstart_compression)
-          .count();
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              tfinish_compression - tstart_compression)
+              .count();
       auto send_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-        tfinish_send - tfinish_compression)
-        .count();
-      auto send_time_seconds = std::chrono::duration_cast<std::chrono::seconds>(
-        tfinish_send - tfinish_compression)
-        .count();
+                           tfinish_send - tfinish_compression)
+                           .count();
       std::cout << "[ " << scount++ << " ] Compression ratio : "
-                << (float(sz32) / result.bytesWritten) << " "
-                << sz32 << " /  " << result.bytesWritten << " ";
-      std::cout << "Time compression : " << compression_time << "ms ("
-                << compression_time_seconds << "s) send: " << send_time << "ms ("
-                << send_time_seconds << "s)" << std::endl;
+                << (float(size) / header.wireSize) << " " << size << " /  "
+                << header.wireSize << " ";
+      std::cout << "Time compression : " << compression_time
+                << "ms send: " << send_time << "ms" << std::endl;
     }
 #endif
-
-    delete[] outCompressed;
   }
-#else
-  size_t TCPFabric::read(void *&mem)
-  {
-    uint32_t sz32 = 0;
-    // Get the size of the bcast being sent to us. Only this part must be
-    // non-blocking, after getting the size we know everyone will enter the
-    // blocking barrier and the blocking bcast where the buffer is sent out.
-    ospcommon::read(connection, &sz32, sizeof(uint32_t));
-    // TODO: Maybe at some point we should dump the buffer if it gets really
-    // large
-    buffer.resize(sz32);
-    mem = buffer.data();
-    ospcommon::read(connection, mem, sz32);
-    return sz32;
-  }
-
-  void TCPFabric::send(void *mem, size_t size)
-  {
-    assert(size < (1LL << 30));
-    uint32_t sz32 = size;
-    // Send the size of the bcast we're sending. Only this part must be
-    // non-blocking, after getting the size we know everyone will enter the
-    // blocking barrier and the blocking bcast where the buffer is sent out.
-    ospcommon::write(connection, &sz32, sizeof(uint32_t));
-    // Now do non-blocking test to see when this bcast is satisfied to avoid
-    // locking out the send/recv threads
-    ospcommon::write(connection, mem, sz32);
-    ospcommon::flush(connection);
-  }
-#endif
-}  // namespace mpicommon
\ No newline at end of file
+}  // namespace mpicommon
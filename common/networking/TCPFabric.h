@@ -31,7 +31,12 @@
 #include "ospcommon/networking/Fabric.h"
 #include "ospcommon/networking/Socket.h"
 
+#include "BufferPool.h"
+#include "Compression.h"
 #include "MPICommon.h"
+#include "TileFrame.h"
+
+#include <memory>
 
 namespace mpicommon {
 
@@ -39,6 +44,11 @@ namespace mpicommon {
   {
     TCPFabric(std::string hostname, int port, bool server = false);
 
+    /*! server side of a port already bound with ospcommon::bind, which
+        listens on it too. With every port bound before any is accepted
+        the client may connect them in any order */
+    TCPFabric(ospcommon::socket_t bound, int port);
+
     virtual ~TCPFabric();
 
     /*! send exact number of bytes - the fabric can do that through
@@ -50,15 +60,59 @@ namespace mpicommon {
       and give us size and pointer to this data */
     virtual size_t read(void *&mem) override;
 
+    /*! same, the message is read straight into a pooled buffer that the
+        caller keeps as long as it needs. Only work frames are expected */
+    std::shared_ptr<byte_t> readShared(size_t &size);
+
+    /*! next frame of any kind, a FRAME_TILE block starts with its
+        TileFrame */
+    std::shared_ptr<byte_t> readShared(size_t &size, FrameKind &kind);
+
+    /*! send a tile on the fast path, tile.size payload bytes follow the
+        header as they are */
+    void sendTile(const TileFrame &tile, const void *payload);
+
+    /*! acknowledge the control message with sequence number seq */
+    void sendAck(uint64_t seq);
+
+    /*! size bytes as one frame of kind, never compressed */
+    void sendFrame(FrameKind kind, const void *mem, size_t size);
+
     virtual bool isServer()
     {
       return server;
     }
 
+    /*! codec used by the next send, CODEC_NONE for payloads that are
+        already compressed */
+    void setCodec(Codec c)
+    {
+      codec = c;
+    }
+
+    struct FrameHeader
+    {
+      uint32_t rawSize;
+      uint32_t wireSize;
+      uint32_t codec;
+      uint32_t kind{FRAME_WORK};
+    };
+
+    /*! bytes sent on the tile fast path, framing is both headers */
+    struct TileStats
+    {
+      uint64_t tiles{0};
+      uint64_t framingBytes{0};
+      uint64_t payloadBytes{0};
+    };
+    TileStats tileStats;
+
    private:
     // wait for Bcast with non-blocking test, and barrier
     // void waitForBcast(MPI_Request &);
-    std::vector<byte_t> buffer;
+    std::shared_ptr<byte_t> current;
+    std::vector<byte_t> scratch;
+    Codec codec{defaultCodec()};
     std::string hostname;
     int port;
     ospcommon::socket_t connection;
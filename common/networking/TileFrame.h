@@ -0,0 +1,79 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace mpicommon {
+
+  /*! bumped whenever TileFrame changes, both ends have to agree */
+  constexpr uint16_t TILE_FRAME_VERSION = 1;
+
+  /*! kind of a TCPFabric frame, tiles take the fast path and everything
+      else is a serialized work object. Control messages are acknowledged
+      with their sequence number as they are received */
+  enum FrameKind : uint32_t
+  {
+    FRAME_WORK,
+    FRAME_TILE,
+    FRAME_ACK,
+    FRAME_HELLO
+  };
+
+  /*! first frame on the control channel, sent by the farm master once it
+      connects. The display side adopts the farm tile size */
+  struct Hello
+  {
+    uint16_t version{TILE_FRAME_VERSION};
+    uint16_t reserved{0};
+    int32_t tileSize{0};
+  };
+
+  /*! fixed header of a FRAME_TILE frame, the tile message follows it in
+      the same frame. Read in place from the block it arrives in */
+  struct TileFrame
+  {
+    uint16_t version{TILE_FRAME_VERSION};
+    // Codec of the payload, the fabric does not compress tile frames
+    uint16_t codec{0};
+    // MASTER_WRITE_TILE_* command of the tile message
+    int32_t command{0};
+    int64_t fbHandle{0};
+    int32_t frame{0};
+    // Tile origin in pixels
+    int32_t x{0};
+    int32_t y{0};
+    // Tile message bytes, before and after compression
+    uint32_t rawSize{0};
+    uint32_t size{0};
+    uint32_t reserved{0};
+  };
+
+  static_assert(sizeof(TileFrame) == 40, "TileFrame is part of the protocol");
+
+}  // namespace mpicommon
@@ -27,14 +27,48 @@
  */
 
 #include "DWwork.h"
+#include <common/networking/SharedReadStream.h>
 
 ospray::dw::SetTile::SetTile(ospray::ObjectHandle &handle,
                              const uint64 &size,
-                             const byte_t *msg)
-    : fbHandle(handle), size(size)
+                             const byte_t *msg,
+                             const int32 command,
+                             const vec2i &coords,
+                             mpicommon::Codec codec,
+                             const uint64 &rawSize,
+                             const int32 frame)
+    : fbHandle(handle),
+      size(size),
+      codec(codec),
+      rawSize(codec == mpicommon::CODEC_NONE ? size : rawSize),
+      frame(frame),
+      command(command),
+      coords(coords)
 {
-  data = (byte_t *)malloc(size);
-  std::memcpy(data, msg, size);
+  data = mpicommon::allocateBuffer(size);
+  std::memcpy(data.get(), msg, size);
+}
+
+ospray::dw::SetTile::SetTile(std::shared_ptr<byte_t> block, size_t blockSize)
+{
+  if (blockSize < sizeof(mpicommon::TileFrame))
+    throw std::runtime_error("Tile frame is too short");
+  auto *header = (const mpicommon::TileFrame *)block.get();
+  if (header->version != mpicommon::TILE_FRAME_VERSION)
+    throw std::runtime_error("Tile frame version " +
+                             std::to_string(header->version) +
+                             " does not match this build");
+  if (sizeof(mpicommon::TileFrame) + header->size != blockSize)
+    throw std::runtime_error("Tile frame size does not match its header");
+
+  fbHandle.i64 = header->fbHandle;
+  size         = header->size;
+  codec        = header->codec;
+  rawSize      = header->rawSize;
+  frame        = header->frame;
+  command      = header->command;
+  coords       = vec2i(header->x, header->y);
+  data         = std::shared_ptr<byte_t>(block, block.get() + sizeof(*header));
 }
 
 void ospray::dw::SetTile::runOnMaster()
@@ -52,20 +86,238 @@ void ospray::dw::SetTile::run()
 void ospray::dw::SetTile::serialize(networking::WriteStream &b) const
 {
   b << (int64)fbHandle;
+  b << (int32)frame;
+  b << (uint32)codec;
+  b << (uint64)rawSize;
+  b << (int32)command;
+  b << coords;
   b << (uint64)size;
-  b.write(data, size);
+  b.write(data.get(), size);
 }
 
 void ospray::dw::SetTile::deserialize(networking::ReadStream &b)
 {
   b >> fbHandle.i64;
+  b >> frame;
+  b >> codec;
+  b >> rawSize;
+  b >> command;
+  b >> coords;
   b >> size;
-  data = (byte_t *)malloc(size);
-  b.read(data, size);
+  // Straight from the socket buffer when the stream allows it
+  auto shared = dynamic_cast<mpicommon::SharedReadStream *>(&b);
+  if (shared) {
+    data = shared->view(size);
+    return;
+  }
+  data = mpicommon::allocateBuffer(size);
+  b.read(data.get(), size);
+  mpicommon::copyStats().count(size);
+}
+
+ospray::dw::SetTile::~SetTile() {}
+
+void ospray::dw::SetTile::compress(mpicommon::Codec codec)
+{
+  if (isCompressed() || codec == mpicommon::CODEC_NONE || !size)
+    return;
+  thread_local std::vector<byte_t> compressed;
+  compressTileMessage(data.get(), size, codec, compressed);
+  data = mpicommon::allocateBuffer(compressed.size());
+  std::memcpy(data.get(), compressed.data(), compressed.size());
+  this->codec = codec;
+  rawSize     = size;
+  size        = compressed.size();
+}
+
+void ospray::dw::SetTile::markUnchanged()
+{
+  data.reset();
+  size    = 0;
+  rawSize = 0;
+  codec   = mpicommon::CODEC_NONE;
+  command |= DW_TILE_UNCHANGED;
+}
+
+mpicommon::TileFrame ospray::dw::SetTile::tileFrame() const
+{
+  mpicommon::TileFrame header;
+  header.codec    = codec;
+  header.command  = command;
+  header.fbHandle = fbHandle.i64;
+  header.frame    = frame;
+  header.x        = coords.x;
+  header.y        = coords.y;
+  header.rawSize  = rawSize;
+  header.size     = size;
+  return header;
+}
+
+ospray::dw::SetTileMask::SetTileMask(ospray::ObjectHandle &handle,
+                                     const vec2i &numTiles,
+                                     const std::vector<byte_t> &mask)
+    : fbHandle(handle), numTiles(numTiles), mask(mask)
+{
+}
+
+void ospray::dw::SetTileMask::runOnMaster()
+{
+  throw std::runtime_error(
+      "Instanced the wrong  SetTileMask classs check your work resgistry");
+}
+
+void ospray::dw::SetTileMask::run()
+{
+  throw std::runtime_error(
+      "Instanced the wrong  SetTileMask classs check your work resgistry");
+}
+
+void ospray::dw::SetTileMask::serialize(networking::WriteStream &b) const
+{
+  b << (int64)fbHandle;
+  b << numTiles;
+  b << (uint64)mask.size();
+  b.write(mask.data(), mask.size());
+}
+
+void ospray::dw::SetTileMask::deserialize(networking::ReadStream &b)
+{
+  uint64 size;
+  b >> fbHandle.i64;
+  b >> numTiles;
+  b >> size;
+  mask.resize(size);
+  b.read(mask.data(), size);
+}
+
+ospray::dw::FrameEnd::FrameEnd(ospray::ObjectHandle &handle,
+                               const int32 frame)
+    : fbHandle(handle), frame(frame)
+{
+}
+
+void ospray::dw::FrameEnd::runOnMaster()
+{
+  throw std::runtime_error(
+      "Instanced the wrong  FrameEnd classs check your work resgistry");
+}
+
+void ospray::dw::FrameEnd::run()
+{
+  throw std::runtime_error(
+      "Instanced the wrong  FrameEnd classs check your work resgistry");
+}
+
+void ospray::dw::FrameEnd::serialize(networking::WriteStream &b) const
+{
+  b << (int64)fbHandle;
+  b << (int32)frame;
+  b << (int32)dropped;
+  b << renderTime;
+}
+
+void ospray::dw::FrameEnd::deserialize(networking::ReadStream &b)
+{
+  int32 wasDropped;
+  b >> fbHandle.i64;
+  b >> frame;
+  b >> wasDropped;
+  b >> renderTime;
+  dropped = wasDropped;
+}
+
+ospray::dw::SetTileCodec::SetTileCodec(const uint32 codec) : codec(codec) {}
+
+void ospray::dw::SetTileCodec::runOnMaster()
+{
+  throw std::runtime_error(
+      "Instanced the wrong  SetTileCodec classs check your work resgistry");
+}
+
+void ospray::dw::SetTileCodec::run()
+{
+  throw std::runtime_error(
+      "Instanced the wrong  SetTileCodec classs check your work resgistry");
+}
+
+void ospray::dw::SetTileCodec::serialize(networking::WriteStream &b) const
+{
+  b << codec;
+}
+
+void ospray::dw::SetTileCodec::deserialize(networking::ReadStream &b)
+{
+  b >> codec;
+}
+
+ospray::dw::SetRegionOfInterest::SetRegionOfInterest(
+    ospray::ObjectHandle &handle, const RegionOfInterest &region)
+    : fbHandle(handle), region(region)
+{
+}
+
+void ospray::dw::SetRegionOfInterest::runOnMaster()
+{
+  throw std::runtime_error(
+      "Instanced the wrong  SetRegionOfInterest classs check your work "
+      "resgistry");
+}
+
+void ospray::dw::SetRegionOfInterest::run()
+{
+  throw std::runtime_error(
+      "Instanced the wrong  SetRegionOfInterest classs check your work "
+      "resgistry");
+}
+
+void ospray::dw::SetRegionOfInterest::serialize(
+    networking::WriteStream &b) const
+{
+  b << (int64)fbHandle;
+  b << region.center;
+  b << region.radius;
+  b << (int32)region.active;
+}
+
+void ospray::dw::SetRegionOfInterest::deserialize(networking::ReadStream &b)
+{
+  int32 active;
+  b >> fbHandle.i64;
+  b >> region.center;
+  b >> region.radius;
+  b >> active;
+  region.active = active;
+}
+
+const ospray::byte_t *ospray::dw::SetTile::tileMessage(
+    std::vector<byte_t> &scratch) const
+{
+  if (!isCompressed())
+    return data.get();
+  std::vector<byte_t> &shuffled = scratch;
+  shuffled.resize(
+      mpicommon::maxUncompressedSize(mpicommon::Codec(codec), rawSize) +
+      rawSize);
+  byte_t *planes = shuffled.data() + rawSize;
+  mpicommon::uncompress(mpicommon::Codec(codec),
+                        data.get(),
+                        size,
+                        planes,
+                        shuffled.size() - rawSize);
+  mpicommon::unshuffle(planes, shuffled.data(), rawSize, sizeof(uint32));
+  mpicommon::copyStats().count(rawSize);
+  return shuffled.data();
 }
 
-ospray::dw::SetTile::~SetTile()
+void ospray::dw::compressTileMessage(const byte_t *msg,
+                                     size_t size,
+                                     mpicommon::Codec codec,
+                                     std::vector<byte_t> &out)
 {
-  if (data != nullptr)
-    free(data);
+  thread_local std::vector<byte_t> planes;
+  planes.resize(size);
+  mpicommon::shuffle(msg, planes.data(), size, sizeof(uint32));
+  out.resize(mpicommon::maxCompressedSize(codec, size));
+  out.resize(mpicommon::compress(
+      codec, planes.data(), size, out.data(), out.size()));
 }
@@ -28,32 +28,217 @@
 
 #pragma once
 
+#include <common/networking/BufferPool.h>
+#include <common/networking/Compression.h>
+#include <common/networking/TileFrame.h>
 #include <mpi/common/OSPWork.h>
 #include <ospray/fb/FrameBuffer.h>
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace ospray {
   namespace dw {
 
+    enum
+    {
+      // Tile command bit, the display already has these pixels
+      DW_TILE_UNCHANGED = 1 << 21,
+      // Tile command bit, a float of depth per pixel follows the color of
+      // the tile message
+      DW_TILE_DEPTH = 1 << 22
+    };
+
+    /*! point of a frame buffer in pixels the tiles are rendered and
+        sent closest first, tiles within radius of it are the region */
+    struct RegionOfInterest
+    {
+      vec2f center{0.f};
+      float radius{0.f};
+      bool active{false};
+
+      /*! pixels from center to the closest point of the box */
+      float distance(const box2f &box) const
+      {
+        const vec2f closest(std::min(std::max(center.x, box.lower.x),
+                                     box.upper.x),
+                            std::min(std::max(center.y, box.lower.y),
+                                     box.upper.y));
+        return length(closest - center);
+      }
+
+      bool contains(const box2f &box) const
+      {
+        return active && distance(box) <= radius;
+      }
+
+      bool operator==(const RegionOfInterest &other) const
+      {
+        return active == other.active &&
+               (!active || (center == other.center && radius == other.radius));
+      }
+    };
+
     struct SetTile : public mpi::work::Work
     {
       SetTile() = default;
 
       SetTile(ospray::ObjectHandle &handle,
               const uint64 &size,
-              const byte_t *msg);
+              const byte_t *msg,
+              const int32 command,
+              const vec2i &coords,
+              mpicommon::Codec codec = mpicommon::CODEC_NONE,
+              const uint64 &rawSize  = 0,
+              const int32 frame      = 0);
+      /*! tile read from a FRAME_TILE block, data stays a view into it */
+      SetTile(std::shared_ptr<byte_t> block, size_t blockSize);
       ~SetTile() override;
       virtual void run() override;
       virtual void runOnMaster() override;
       void serialize(networking::WriteStream &b) const;
       void deserialize(networking::ReadStream &b) override;
 
+      bool isCompressed() const
+      {
+        return codec != mpicommon::CODEC_NONE;
+      }
+
+      /*! compress the tile message if it is not already */
+      void compress(mpicommon::Codec codec);
+
+      /*! drop the pixels, the display keeps the ones it has */
+      void markUnchanged();
+      bool isUnchanged() const
+      {
+        return command & DW_TILE_UNCHANGED;
+      }
+
+      /*! fast path header, the payload is data */
+      mpicommon::TileFrame tileFrame() const;
+      const byte_t *payload() const
+      {
+        return data.get();
+      }
+      uint64 payloadSize() const
+      {
+        return size;
+      }
+      const vec2i &tileCoords() const
+      {
+        return coords;
+      }
+      const ObjectHandle &frameBuffer() const
+      {
+        return fbHandle;
+      }
+
+      // Farm side only, tileError of the tile when it was completed
+      float error{inf};
+      // Farm side only, pixels to the region of interest, the closest
+      // queued tiles are sent first
+      int32 priority{0};
+
+      /*! tile message, uncompressed into scratch if needed */
+      const byte_t *tileMessage(std::vector<byte_t> &scratch) const;
+
+      int32 frameID() const
+      {
+        return frame;
+      }
+
      protected:
       ospray::ObjectHandle fbHandle;
       uint64 size;
-      byte_t *data;
+      // Pooled, or a view into the block it was read from
+      std::shared_ptr<byte_t> data;
+      uint32 codec{mpicommon::CODEC_NONE};
+      uint64 rawSize{0};
+      // Farm frame the tile was rendered in
+      int32 frame{0};
+      // MASTER_WRITE_TILE_* command and origin of the tile message, known
+      // without uncompressing it
+      int32 command{0};
+      vec2i coords{0};
+    };
+
+    /*! tiles that are visible on the wall, tiles fully hidden behind the
+        bezels are neither rendered nor sent */
+    struct SetTileMask : public mpi::work::Work
+    {
+      SetTileMask() = default;
+      SetTileMask(ospray::ObjectHandle &handle,
+                  const vec2i &numTiles,
+                  const std::vector<byte_t> &mask);
+      virtual void run() override;
+      virtual void runOnMaster() override;
+      void serialize(networking::WriteStream &b) const;
+      void deserialize(networking::ReadStream &b) override;
+
+     protected:
+      ospray::ObjectHandle fbHandle;
+      vec2i numTiles;
+      std::vector<byte_t> mask;
+    };
+
+    /*! sent by the farm after the last tile of a frame, dropped when some
+        of its tiles were skipped because a newer frame was ready. The
+        display head acknowledges frames with it */
+    struct FrameEnd : public mpi::work::Work
+    {
+      FrameEnd() = default;
+      FrameEnd(ospray::ObjectHandle &handle, const int32 frame);
+      virtual void run() override;
+      virtual void runOnMaster() override;
+      void serialize(networking::WriteStream &b) const;
+      void deserialize(networking::ReadStream &b) override;
+
+      int32 frame{0};
+      bool dropped{false};
+      // ms the farm master spent in the RenderFrame of the frame
+      float renderTime{0.f};
+
+     protected:
+      ospray::ObjectHandle fbHandle;
+    };
+
+    /*! codec the farm compresses tiles with from its next frame on,
+        CODEC_NONE sends them raw. Tiles say their codec, the display only
+        sends it */
+    struct SetTileCodec : public mpi::work::Work
+    {
+      SetTileCodec() = default;
+      SetTileCodec(const uint32 codec);
+      virtual void run() override;
+      virtual void runOnMaster() override;
+      void serialize(networking::WriteStream &b) const;
+      void deserialize(networking::ReadStream &b) override;
+
+      uint32 codec{mpicommon::CODEC_NONE};
+    };
+
+    /*! region of interest of a frame buffer from its next frame on */
+    struct SetRegionOfInterest : public mpi::work::Work
+    {
+      SetRegionOfInterest() = default;
+      SetRegionOfInterest(ospray::ObjectHandle &handle,
+                          const RegionOfInterest &region);
+      virtual void run() override;
+      virtual void runOnMaster() override;
+      void serialize(networking::WriteStream &b) const;
+      void deserialize(networking::ReadStream &b) override;
+
+     protected:
+      ospray::ObjectHandle fbHandle;
+      RegionOfInterest region;
     };
 
+    /*! compress a final tile message as it goes out of its owner rank */
+    void compressTileMessage(const byte_t *msg,
+                             size_t size,
+                             mpicommon::Codec codec,
+                             std::vector<byte_t> &out);
+
   }  // namespace dw
 }  // namespace ospray
\ No newline at end of file
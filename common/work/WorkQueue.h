@@ -0,0 +1,99 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace ospray {
+  namespace dw {
+
+    /*! blocking FIFO used to hand work between the communication threads
+        and the thread that processes it */
+    template <typename T>
+    struct WorkQueue
+    {
+      void push(T &&item)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          items.push_back(std::move(item));
+        }
+        condition.notify_one();
+      }
+
+      T pop()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&] { return !items.empty(); });
+        T item = std::move(items.front());
+        items.pop_front();
+        return item;
+      }
+
+      /*! pop the item with the lowest priority among the next window
+          items, the first of them on a tie. An item with a negative
+          priority is never passed by the ones behind it */
+      template <typename Priority>
+      T pop(Priority priority, size_t window)
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&] { return !items.empty(); });
+        auto best      = items.begin();
+        auto lowest    = priority(*best);
+        const auto end = items.begin() + std::min(window, items.size());
+        for (auto item = best + 1; lowest > 0 && item != end; ++item) {
+          const auto rank = priority(*item);
+          if (rank < 0)
+            break;
+          if (rank < lowest) {
+            best   = item;
+            lowest = rank;
+          }
+        }
+        T item = std::move(*best);
+        items.erase(best);
+        return item;
+      }
+
+      size_t size()
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+      }
+
+     private:
+      std::mutex mutex;
+      std::condition_variable condition;
+      std::deque<T> items;
+    };
+
+  }  // namespace dw
+}  // namespace ospray
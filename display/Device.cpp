@@ -35,7 +35,32 @@
 #include <display/glDisplay/glDisplay.h>
 #include <farm/fb/FarmFramebuffer.h>
 
-ospray::dw::display::Device::~Device() {}
+ospray::dw::display::Device::~Device()
+{
+  if (!receiveThread.joinable())
+    return;
+  // The farm acknowledges the finalize like any command and answers with
+  // a finalize of its own on the bulk channel once the tiles it still had
+  // went out
+  {
+    std::lock_guard<std::mutex> lock(control);
+    controlSent.push_back(std::chrono::steady_clock::now());
+    finalizing = true;
+  }
+  try {
+    mpi::work::CommandFinalize finalize;
+    auto tag = typeIdOf(finalize);
+    tcpwriteStream->write(&tag, sizeof(tag));
+    finalize.serialize(*tcpwriteStream);
+    tcpwriteStream->flush();
+  } catch (const std::exception &e) {
+    // The farm is gone already, both threads stop on its disconnect
+    std::cerr << "Unable to send the finalize to the farm : " << e.what()
+              << std::endl;
+  }
+  receiveThread.join();
+  controlThread.join();
+}
 
 void ospray::dw::display::Device::initializeDevice()
 {
@@ -108,12 +133,43 @@ void ospray::dw::display::Device::commit()
     auto DW_HOSTPORT = utility::getEnvVar<int>("DW_HOSTPORT").value_or(4444);
     std::cout << "Waiting farm connection on : " << DW_HOSTNAME << ":"
               << DW_HOSTPORT << std::endl;
-    tcpFabric =
-        make_unique<mpicommon::TCPFabric>(DW_HOSTNAME, DW_HOSTPORT, true);
-
-    tcpreadStream  = make_unique<networking::BufferedReadStream>(*tcpFabric);
+    // The farm connects the bulk port right after the control one, both
+    // listen before either is accepted
+    auto controlSocket = ospcommon::bind(DW_HOSTPORT);
+    auto bulkSocket    = ospcommon::bind(DW_HOSTPORT + 1);
+    tcpFabric  = make_unique<mpicommon::TCPFabric>(controlSocket, DW_HOSTPORT);
+    bulkFabric = make_unique<mpicommon::TCPFabric>(bulkSocket, DW_HOSTPORT + 1);
+
+    // Tiles are handed out as views into the blocks read from the socket
+    tcpreadStream  = make_unique<mpicommon::SharedReadStream>(*bulkFabric);
     tcpwriteStream = make_unique<networking::BufferedWriteStream>(*tcpFabric);
     std::cout << "Farm connected" << std::endl;
+
+    // The farm says its tile size first, the display ranks adopt it before
+    // any frame buffer is created
+    size_t size;
+    mpicommon::FrameKind kind;
+    auto block  = tcpFabric->readShared(size, kind);
+    auto *hello = (const mpicommon::Hello *)block.get();
+    if (kind != mpicommon::FRAME_HELLO || size != sizeof(mpicommon::Hello))
+      throw std::runtime_error("Expected the farm hello");
+    if (hello->version != mpicommon::TILE_FRAME_VERSION)
+      throw std::runtime_error("Farm tile frame version " +
+                               std::to_string(hello->version) +
+                               " does not match this build");
+    std::cout << "Farm tile size : " << hello->tileSize << std::endl;
+    display::SetTileSize tileSizeWork(hello->tileSize);
+    auto tag = typeIdOf(tileSizeWork);
+    writeStream->write(&tag, sizeof(tag));
+    tileSizeWork.serialize(*writeStream);
+    writeStream->flush();
+    tileSizeWork.runOnMaster();
+
+    frameWindow = std::max(
+        utility::getEnvVar<int>("DW_FRAME_WINDOW").value_or(1), 1);
+    governor = make_unique<QualityGovernor>();
+    receiveThread = std::thread([&] { receiveLoop(); });
+    controlThread = std::thread([&] { controlLoop(); });
   }
 
   auto OSPRAY_DYNAMIC_LOADBALANCER =
@@ -132,12 +188,43 @@ void ospray::dw::display::Device::commit()
       ObjectHandle(), useDynamicLoadBalancer, preAllocatedTiles);
 
   processWork(slbWork);
+
+  auto DW_DYNAMIC_RESOLUTION =
+      utility::getEnvVar<int>("DW_DYNAMIC_RESOLUTION");
+  dynamicResolution = getParam<int>("dynamicResolution",
+                                    DW_DYNAMIC_RESOLUTION.value_or(0));
+
+  auto DW_TARGET_FRAME_MS = utility::getEnvVar<float>("DW_TARGET_FRAME_MS");
+  targetFrameTime         = std::max(
+      getParam<float>("targetFrameTime", DW_TARGET_FRAME_MS.value_or(33.f)),
+      1.f);
+
+  auto DW_QUALITY_GOVERNOR = utility::getEnvVar<int>("DW_QUALITY_GOVERNOR");
+  qualityGovernor =
+      getParam<int>("qualityGovernor", DW_QUALITY_GOVERNOR.value_or(0));
+  governor->configure(targetFrameTime,
+                      dynamicResolution || qualityGovernor,
+                      qualityGovernor,
+                      qualityGovernor);
+
+  regionOfInterestRadius =
+      utility::getEnvVar<float>("DW_ROI_RADIUS").value_or(256.f);
+
+  auto DW_REPROJECT = utility::getEnvVar<int>("DW_REPROJECT");
+  reprojection = getParam<int>("reproject", DW_REPROJECT.value_or(0));
 }
 
 void ospray::dw::display::Device::processWork(mpi::work::Work &work,
                                               bool flushWriteStream)
 {
   auto tag = typeIdOf(work);
+  // Something changed for the next frame, the governor may lower its quality
+  if (!governing && tag == typeIdOf<mpi::work::CommitObject>())
+    interacting = true;
+  {
+    std::lock_guard<std::mutex> lock(control);
+    controlSent.push_back(std::chrono::steady_clock::now());
+  }
   tcpwriteStream->write(&tag, sizeof(tag));
   work.serialize(*tcpwriteStream);
   tcpwriteStream->flush();
@@ -153,27 +240,342 @@ OSPFrameBuffer ospray::dw::display::Device::frameBufferCreate(
 {
   ObjectHandle handle = allocateHandle();
 
+  // The display ranks reproject with depth, the channels the application
+  // asked for go through as they are otherwise
+  const uint32 fbChannels = reprojection ? channels | OSP_FB_DEPTH : channels;
+
   display::CreateFrameBuffer tcpwork(
-      handle, wc->completeScreeen, mode, channels);
+      handle, wc->completeScreeen, mode, fbChannels);
   processWork(tcpwork);
 
-  display::CreateFrameBuffer work(handle, size, mode, channels);
+  display::CreateFrameBuffer work(handle, size, mode, fbChannels);
   auto tag = typeIdOf(work);
   writeStream->write(&tag, sizeof(tag));
   work.serialize(*writeStream);
   writeStream->flush();
   work.runOnMaster();
+
+  display::SetTileMask maskwork(handle, wc->maxTiles, wc->tileMask());
+  processWork(maskwork);
   return (OSPFrameBuffer)(int64)handle;
 }
+
+ospray::ObjectHandle ospray::dw::display::Device::scaledFrameBuffer(
+    const ObjectHandle &fb, DisplayFramebuffer *dfb, const int scale)
+{
+  const auto key = std::make_pair((int64)fb, scale);
+  auto scaled    = scaledFrameBuffers.find(key);
+  if (scaled != scaledFrameBuffers.end())
+    return scaled->second;
+
+  // Without depth, the display ranks only reproject full scale frames
+  uint32 channels = OSP_FB_COLOR;
+  if (dfb->hasAccumBuffer)
+    channels |= OSP_FB_ACCUM;
+  if (dfb->hasVarianceBuffer)
+    channels |= OSP_FB_VARIANCE;
+
+  // Farm only, without a tile mask. The screens reach past the bezels
+  // to upscale their edges
+  ObjectHandle handle = allocateHandle();
+  display::CreateFrameBuffer work(
+      handle,
+      divRoundUp(wc->completeScreeen, vec2i(scale)),
+      (OSPFrameBufferFormat)dfb->colorBufferFormat,
+      channels);
+  processWork(work);
+  handle.assign(dfb);
+  scaledFrameBuffers[key] = handle;
+  return handle;
+}
+
+void ospray::dw::display::Device::frameBufferClear(
+    OSPFrameBuffer _fb, const ospray::uint32 fbChannelFlags)
+{
+  MPIOffloadDevice::frameBufferClear(_fb, fbChannelFlags);
+  // The lower scale copies accumulate on their own
+  for (auto &scaled : scaledFrameBuffers) {
+    if (scaled.first.first == (int64)_fb)
+      MPIOffloadDevice::frameBufferClear(
+          (OSPFrameBuffer)(int64)scaled.second, fbChannelFlags);
+  }
+}
+
+void ospray::dw::display::Device::release(OSPObject _obj)
+{
+  for (auto scaled = scaledFrameBuffers.begin();
+       scaled != scaledFrameBuffers.end();) {
+    if (scaled->first.first == (int64)_obj) {
+      sentRegions.erase((int64)scaled->second);
+      MPIOffloadDevice::release((OSPObject)(int64)scaled->second);
+      scaled = scaledFrameBuffers.erase(scaled);
+    } else {
+      ++scaled;
+    }
+  }
+  regionsOfInterest.erase((int64)_obj);
+  sentRegions.erase((int64)_obj);
+  cameras.erase((int64)_obj);
+  rendererCameras.erase((int64)_obj);
+  committedCameras.erase((int64)_obj);
+  committedRendererCameras.erase((int64)_obj);
+  uncommitted.erase((int64)_obj);
+  MPIOffloadDevice::release(_obj);
+}
+
+void ospray::dw::display::Device::parameterSet(OSPObject _object)
+{
+  if (!governing)
+    uncommitted.insert((int64)_object);
+}
+
+void ospray::dw::display::Device::commit(OSPObject _object)
+{
+  const int64 object = (int64)_object;
+  uncommitted.erase(object);
+  auto camera = cameras.find(object);
+  if (camera != cameras.end())
+    committedCameras[object] = camera->second;
+  auto rendererCamera = rendererCameras.find(object);
+  if (rendererCamera != rendererCameras.end())
+    committedRendererCameras[object] = rendererCamera->second;
+  MPIOffloadDevice::commit(_object);
+}
+
+void ospray::dw::display::Device::setString(OSPObject _object,
+                                            const char *bufName,
+                                            const char *s)
+{
+  parameterSet(_object);
+  MPIOffloadDevice::setString(_object, bufName, s);
+}
+
+void ospray::dw::display::Device::setVec2i(OSPObject _object,
+                                           const char *bufName,
+                                           const vec2i &v)
+{
+  parameterSet(_object);
+  MPIOffloadDevice::setVec2i(_object, bufName, v);
+}
+
+void ospray::dw::display::Device::setVec3i(OSPObject _object,
+                                           const char *bufName,
+                                           const vec3i &v)
+{
+  parameterSet(_object);
+  MPIOffloadDevice::setVec3i(_object, bufName, v);
+}
+
+void ospray::dw::display::Device::setVec4f(OSPObject _object,
+                                           const char *bufName,
+                                           const vec4f &v)
+{
+  parameterSet(_object);
+  MPIOffloadDevice::setVec4f(_object, bufName, v);
+}
+
+void ospray::dw::display::Device::setVoidPtr(OSPObject _object,
+                                             const char *bufName,
+                                             void *v)
+{
+  parameterSet(_object);
+  MPIOffloadDevice::setVoidPtr(_object, bufName, v);
+}
+
+void ospray::dw::display::Device::setInt(OSPObject _object,
+                                         const char *bufName,
+                                         const int f)
+{
+  // Samples the application asks for, the governor may render fewer
+  if (!governing && std::string(bufName) == "spp") {
+    appSamples[(int64)_object]  = f;
+    sentSamples[(int64)_object] = f;
+  }
+  parameterSet(_object);
+  MPIOffloadDevice::setInt(_object, bufName, f);
+}
+
+void ospray::dw::display::Device::setVec2f(OSPObject _object,
+                                           const char *bufName,
+                                           const vec2f &v)
+{
+  // Head only, normalized with the origin at the lower left. Negative
+  // coordinates clear it
+  if (std::string(bufName) == "regionOfInterest") {
+    if (v.x < 0.f || v.y < 0.f)
+      regionsOfInterest.erase((int64)_object);
+    else
+      regionsOfInterest[(int64)_object] = v;
+    return;
+  }
+  parameterSet(_object);
+  MPIOffloadDevice::setVec2f(_object, bufName, v);
+}
+
+OSPCamera ospray::dw::display::Device::newCamera(const char *type)
+{
+  OSPCamera camera = MPIOffloadDevice::newCamera(type);
+  if (std::string(type) == "perspective")
+    cameras[(int64)camera].valid = true;
+  return camera;
+}
+
+void ospray::dw::display::Device::setFloat(OSPObject _object,
+                                           const char *bufName,
+                                           const float f)
+{
+  auto camera = cameras.find((int64)_object);
+  if (camera != cameras.end()) {
+    const std::string name(bufName);
+    if (name == "fovy")
+      camera->second.fovy = f;
+    else if (name == "aspect")
+      camera->second.aspect = f;
+  }
+  parameterSet(_object);
+  MPIOffloadDevice::setFloat(_object, bufName, f);
+}
+
+void ospray::dw::display::Device::setVec3f(OSPObject _object,
+                                           const char *bufName,
+                                           const vec3f &v)
+{
+  auto camera = cameras.find((int64)_object);
+  if (camera != cameras.end()) {
+    const std::string name(bufName);
+    if (name == "pos")
+      camera->second.pos = v;
+    else if (name == "dir")
+      camera->second.dir = v;
+    else if (name == "up")
+      camera->second.up = v;
+  }
+  parameterSet(_object);
+  MPIOffloadDevice::setVec3f(_object, bufName, v);
+}
+
+void ospray::dw::display::Device::setObject(OSPObject _object,
+                                            const char *bufName,
+                                            OSPObject obj)
+{
+  if (std::string(bufName) == "camera")
+    rendererCameras[(int64)_object] = (int64)obj;
+  parameterSet(_object);
+  MPIOffloadDevice::setObject(_object, bufName, obj);
+}
+
+ospray::dw::display::FrameCamera ospray::dw::display::Device::frameCamera(
+    OSPRenderer _renderer)
+{
+  // As the application last committed them, what the farm renders with
+  auto renderer = committedRendererCameras.find((int64)_renderer);
+  if (!reprojection || renderer == committedRendererCameras.end())
+    return FrameCamera();
+  auto camera = committedCameras.find(renderer->second);
+  return camera != committedCameras.end() ? camera->second : FrameCamera();
+}
+
+ospray::dw::RegionOfInterest ospray::dw::display::Device::regionOfInterest(
+    OSPFrameBuffer _fb)
+{
+  RegionOfInterest region;
+  auto point = regionsOfInterest.find((int64)_fb);
+  if (point != regionsOfInterest.end()) {
+    region.center = point->second * vec2f(wc->completeScreeen);
+    region.radius = regionOfInterestRadius;
+    region.active = true;
+  }
+  return region;
+}
+
+ospray::dw::display::QualitySettings
+ospray::dw::display::Device::nextSettings(DisplayFramebuffer *dfb,
+                                          OSPRenderer _renderer)
+{
+  const bool moving = interacting;
+  interacting       = false;
+
+  const int64 renderer = (int64)_renderer;
+  const int appSpp =
+      appSamples.count(renderer) ? std::max(appSamples[renderer], 1) : 1;
+  QualitySettings settings = governor->decide(moving, appSpp);
+  // Puts from the head only exist at full scale
+  if (dfb->useRMA)
+    settings.scaleLevel = 0;
+
+  if (settings.compress != tilesCompressed) {
+    display::SetTileCodec work(settings.compress ? mpicommon::defaultCodec()
+                                                 : mpicommon::CODEC_NONE);
+    processWork(work);
+    tilesCompressed = settings.compress;
+  }
+
+  // Committed like any parameter, without counting as an interaction. A
+  // commit takes every parameter set on the renderer, so the change waits
+  // while the application has some it did not commit yet
+  const int samples =
+      settings.samples ? std::min(settings.samples, appSpp) : appSpp;
+  const auto sent = sentSamples.find(renderer);
+  if ((sent == sentSamples.end() ? samples != appSpp
+                                 : sent->second != samples) &&
+      !uncommitted.count(renderer)) {
+    governing = true;
+    MPIOffloadDevice::setInt((OSPObject)_renderer, "spp", samples);
+    MPIOffloadDevice::commit((OSPObject)_renderer);
+    governing             = false;
+    sentSamples[renderer] = samples;
+  }
+  return settings;
+}
+
+double ospray::dw::display::Device::frameTime()
+{
+  return governor->frameTime();
+}
+
 float ospray::dw::display::Device::renderFrame(
     OSPFrameBuffer _fb,
     OSPRenderer _renderer,
     const ospray::uint32 fbChannelFlags)
 {
-  mpi::work::RenderFrame work(_fb, _renderer, fbChannelFlags);
+  ObjectHandle handle = (const ObjectHandle &)_fb;
+  auto *dfb = dynamic_cast<DisplayFramebuffer *>(handle.lookup());
+  assert(dfb);
+
+  // Numbered the way the farm numbers its frames, the tiles of this one
+  // may arrive before the display ranks start it
+  const int32 frame             = framesRequested + 1;
+  const QualitySettings settings = nextSettings(dfb, _renderer);
+  const int scale                = settings.scale();
+  const RegionOfInterest region  = regionOfInterest(_fb);
+  dfb->setFrameScale(frame, scale);
+  {
+    std::lock_guard<std::mutex> lock(frames);
+    framesPending.push_back(FrameRequest{
+        frame, settings, region, std::chrono::steady_clock::now()});
+  }
+
+  OSPFrameBuffer target = _fb;
+  if (scale > 1)
+    target = (OSPFrameBuffer)(int64)scaledFrameBuffer(handle, dfb, scale);
+
+  // The farm renders and sends the tiles closest to the region first, in
+  // pixels of the buffer it renders
+  RegionOfInterest targetRegion = region;
+  targetRegion.center = targetRegion.center / float(scale);
+  targetRegion.radius = targetRegion.radius / scale;
+  auto &sentRegion = sentRegions[(int64)target];
+  if (!(sentRegion == targetRegion)) {
+    ObjectHandle targetHandle = (const ObjectHandle &)target;
+    display::SetRegionOfInterest regionWork(targetHandle, targetRegion);
+    processWork(regionWork);
+    sentRegion = targetRegion;
+  }
+  mpi::work::RenderFrame work(target, _renderer, fbChannelFlags);
   processWork(work, true);
 
-  display::RenderFrame localrender(_fb, _renderer, fbChannelFlags);
+  display::RenderFrame localrender(
+      _fb, _renderer, fbChannelFlags, frame, scale, frameCamera(_renderer));
   auto tag = typeIdOf(localrender);
   writeStream->write(&tag, sizeof(tag));
   localrender.serialize(*writeStream);
@@ -188,5 +590,213 @@ std::unique_ptr<ospray::mpi::work::Work> ospray::dw::display::Device::readWork()
   return std::move(work);
 }
 
+void ospray::dw::display::Device::receiveLoop()
+{
+  while (true) {
+    size_t size;
+    mpicommon::FrameKind kind;
+    std::shared_ptr<byte_t> block;
+    try {
+      block = bulkFabric->readShared(size, kind);
+    } catch (const std::exception &e) {
+      // The farm closed the connection, nothing more is coming
+      if (!finalizing)
+        std::cerr << "Farm disconnected from the bulk channel : " << e.what()
+                  << std::endl;
+      return;
+    }
+    const auto received = std::chrono::steady_clock::now();
+    if (!receiving) {
+      receiving     = true;
+      firstReceived = received;
+    }
+    receivedBytes += size;
+    if (kind == mpicommon::FRAME_TILE) {
+      auto *header = (const mpicommon::TileFrame *)block.get();
+      receivedRawBytes += sizeof(*header) + header->rawSize;
+      // Decoded in place, without the work registry
+      dw::display::SetTile tile(std::move(block), size);
+      tile.runOnMaster();
+      forwardTime += std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - received)
+                         .count();
+      continue;
+    }
+
+    tcpreadStream->push(std::move(block), size);
+    auto work = readWork();
+    auto tag  = typeIdOf(work);
+    // The answer to the finalize of ~Device, the last frame the farm sends
+    if (tag == typeIdOf<mpi::work::CommandFinalize>())
+      return;
+    // Nothing catches on this thread, a stray work is skipped instead
+    if (tag != typeIdOf<dw::display::SetTile>() &&
+        tag != typeIdOf<dw::display::FrameEnd>()) {
+      std::cerr << "Skipping unexpected " << typeString(work)
+                << " on the bulk channel, only tiles and frame ends come "
+                   "there"
+                << std::endl;
+      continue;
+    }
+    work->runOnMaster();
+  }
+}
+
+void ospray::dw::display::Device::controlLoop()
+{
+  while (true) {
+    size_t size;
+    mpicommon::FrameKind kind;
+    std::shared_ptr<byte_t> block;
+    try {
+      block = tcpFabric->readShared(size, kind);
+    } catch (const std::exception &e) {
+      if (!finalizing)
+        std::cerr << "Farm disconnected from the control channel : "
+                  << e.what() << std::endl;
+      return;
+    }
+    // Nothing catches on this thread, a stray frame is skipped instead
+    if (kind != mpicommon::FRAME_ACK) {
+      std::cerr << "Skipping a frame of kind " << kind
+                << " on the control channel, only acknowledgements come there"
+                << std::endl;
+      continue;
+    }
+    const uint64 seq = *(uint64 *)block.get();
+
+    std::lock_guard<std::mutex> lock(control);
+    // Acknowledgements come in order, one per command
+    for (; controlAcked <= seq && !controlSent.empty(); controlAcked++) {
+      controlLatency.push_back(
+          std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - controlSent.front())
+              .count());
+      controlSent.pop_front();
+    }
+    // The finalize of ~Device was the last command
+    if (finalizing && controlSent.empty())
+      return;
+  }
+}
+
+std::vector<double> ospray::dw::display::Device::takeControlLatency()
+{
+  std::lock_guard<std::mutex> lock(control);
+  std::vector<double> latency;
+  latency.swap(controlLatency);
+  return latency;
+}
+
+void ospray::dw::display::Device::frameFinished(const int32 frame,
+                                                const bool dropped,
+                                                const float renderTime,
+                                                const double presentTime)
+{
+  if (dropped)
+    framesDropped++;
+
+  const auto now = std::chrono::steady_clock::now();
+  FrameMeasurements measured;
+  measured.frame       = frame;
+  measured.dropped     = dropped;
+  measured.renderTime  = renderTime;
+  measured.presentTime = presentTime;
+  measured.bytes       = receivedBytes;
+  measured.rawBytes    = receivedRawBytes;
+  measured.forwardTime = forwardTime;
+  measured.linkTime    = std::chrono::duration<double, std::milli>(
+                          now - firstReceived)
+                          .count();
+  receivedBytes = receivedRawBytes = 0;
+  forwardTime                      = 0.0;
+  receiving                        = false;
+  const bool focused               = focusReached;
+  focusReached                     = false;
+
+  bool requested = false;
+  {
+    std::lock_guard<std::mutex> lock(frames);
+    framesFinished = frame;
+
+    // The farm starts a frame once it is requested and the one before is
+    // done
+    while (!framesPending.empty() && framesPending.front().frame <= frame) {
+      const auto request = framesPending.front();
+      framesPending.pop_front();
+      if (request.frame != frame)
+        continue;
+      // Tiles of the region may come before the frame ahead is done
+      const auto start   = std::max(request.sent, lastFinished);
+      measured.settings  = request.settings;
+      measured.frameTime = std::chrono::duration<double, std::milli>(
+                               now - start)
+                               .count();
+      if (focused) {
+        measured.focusTime = std::max(
+            std::chrono::duration<double, std::milli>(focusForwarded - start)
+                .count(),
+            0.0);
+      }
+      requested = true;
+    }
+    lastFinished = now;
+  }
+  condition_frames.notify_all();
+
+  if (requested) {
+    frameLatency.frame.push_back(measured.frameTime);
+    if (focused)
+      frameLatency.focus.push_back(measured.focusTime);
+    governor->measure(measured);
+  }
+}
+
+bool ospray::dw::display::Device::inRegionOfInterest(const int32 frame,
+                                                     const vec2i &coords,
+                                                     const int tileSize)
+{
+  // Looked up once per frame, its request is pending until its FrameEnd
+  if (frame != focusFrame) {
+    focusFrame  = frame;
+    focusRegion = RegionOfInterest();
+    focusScale  = 1;
+    std::lock_guard<std::mutex> lock(frames);
+    for (auto &request : framesPending) {
+      if (request.frame == frame) {
+        focusRegion = request.region;
+        focusScale  = request.settings.scale();
+        break;
+      }
+    }
+  }
+  if (!focusRegion.active)
+    return false;
+  // A tile of a scaled frame covers scale times its pixels on the wall
+  const vec2f lower(coords * focusScale);
+  return focusRegion.contains(
+      box2f(lower, lower + vec2f(tileSize * focusScale)));
+}
+
+void ospray::dw::display::Device::regionOfInterestForwarded()
+{
+  focusReached   = true;
+  focusForwarded = std::chrono::steady_clock::now();
+}
+
+ospray::dw::display::Device::FrameLatency
+ospray::dw::display::Device::takeFrameLatency()
+{
+  FrameLatency latency;
+  std::swap(latency, frameLatency);
+  return latency;
+}
+
+void ospray::dw::display::Device::waitForFrame(const int32 frame)
+{
+  std::unique_lock<std::mutex> lock(frames);
+  condition_frames.wait(lock, [&] { return framesFinished >= frame; });
+}
+
 OSP_REGISTER_DEVICE(ospray::dw::display::Device, dwdisplay);
 OSP_REGISTER_DEVICE(ospray::dw::display::Device, display);
\ No newline at end of file
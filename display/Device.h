@@ -28,14 +28,29 @@
 #ifndef OSPRAY_DISPLAY_DEVICE_H
 #define OSPRAY_DISPLAY_DEVICE_H
 
-#include <common/networking/TCPFabric.h>
+#include <common/networking/SharedReadStream.h>
+#include <common/work/DWwork.h>
+#include <display/fb/FrameCamera.h>
 #include <display/glDisplay/WallConfig.h>
+#include <display/governor/QualityGovernor.h>
 #include <mpi/MPIOffloadDevice.h>
 #include <mpi/common/OSPWork.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
 namespace ospray {
   namespace dw {
     namespace display {
+      struct DisplayFramebuffer;
+
       struct Device : public ospray::mpi::MPIOffloadDevice
       {
        public:
@@ -48,20 +63,201 @@ namespace ospray {
         OSPFrameBuffer frameBufferCreate(const vec2i &size,
                                          const OSPFrameBufferFormat mode,
                                          const uint32 channels) override;
+        void frameBufferClear(OSPFrameBuffer _fb,
+                              const uint32 fbChannelFlags) override;
+        void release(OSPObject _obj) override;
+        void commit(OSPObject _object) override;
+        void setString(OSPObject _object,
+                       const char *bufName,
+                       const char *s) override;
+        void setInt(OSPObject _object,
+                    const char *bufName,
+                    const int f) override;
+        void setVec2i(OSPObject _object,
+                      const char *bufName,
+                      const vec2i &v) override;
+        void setVec3i(OSPObject _object,
+                      const char *bufName,
+                      const vec3i &v) override;
+        void setVec2f(OSPObject _object,
+                      const char *bufName,
+                      const vec2f &v) override;
+        void setVec4f(OSPObject _object,
+                      const char *bufName,
+                      const vec4f &v) override;
+        void setVoidPtr(OSPObject _object,
+                        const char *bufName,
+                        void *v) override;
+        OSPCamera newCamera(const char *type) override;
+        void setFloat(OSPObject _object,
+                      const char *bufName,
+                      const float f) override;
+        void setVec3f(OSPObject _object,
+                      const char *bufName,
+                      const vec3f &v) override;
+        void setObject(OSPObject _object,
+                       const char *bufName,
+                       OSPObject obj) override;
 
         std::unique_ptr<mpi::work::Work> readWork();
 
+        /*! farm acknowledged frame with its FrameEnd, renderTime and
+            presentTime in ms */
+        void frameFinished(const int32 frame,
+                           const bool dropped,
+                           const float renderTime,
+                           const double presentTime);
+        /*! block until frame was acknowledged */
+        void waitForFrame(const int32 frame);
+        /*! control channel latency, ms from sending a command to the farm
+            master receiving it, of the commands acknowledged since the last
+            call */
+        std::vector<double> takeControlLatency();
+        /*! mean ms of the last frames at the current quality settings */
+        double frameTime();
+
+        /*! receive thread, the tile of frame at coords, in pixels of the
+            buffer the farm renders, is in the region of interest */
+        bool inRegionOfInterest(const int32 frame,
+                                const vec2i &coords,
+                                const int tileSize);
+        /*! receive thread, a tile of the region of interest was forwarded */
+        void regionOfInterestForwarded();
+        /*! ms from the request to the last tile of the region of interest
+            and to the FrameEnd of the frames finished since the last call */
+        struct FrameLatency
+        {
+          std::vector<double> focus;
+          std::vector<double> frame;
+        };
+        FrameLatency takeFrameLatency();
+
         wallconfig *wc;
 
+        /*! DW_FRAME_WINDOW, frames requested from the farm and not yet
+            acknowledged before renderFrame blocks */
+        int frameWindow{1};
+        int32 framesRequested{0};
+        std::atomic<size_t> framesDropped{0};
+
+        /*! dynamicResolution, DW_DYNAMIC_RESOLUTION. While objects are
+            committed between frames the farm renders the wall at 1/2 or
+            1/4 of its size to meet targetFrameTime ms, DW_TARGET_FRAME_MS.
+            The display ranks upscale, the first frame without commits is
+            at full scale again */
+        bool dynamicResolution{false};
+        float targetFrameTime{33.f};
+        /*! qualityGovernor, DW_QUALITY_GOVERNOR. The governor also turns
+            the farm codec and the samples of the renderer */
+        bool qualityGovernor{false};
+        /*! DW_ROI_RADIUS, wall pixels around the "regionOfInterest" of a
+            frame buffer that make up the region */
+        float regionOfInterestRadius{256.f};
+        /*! reproject, DW_REPROJECT. The farm sends depth with the tiles and
+            the display ranks show the last frame through the camera of the
+            next one until its tiles arrive. Perspective cameras only */
+        bool reprojection{false};
+
        protected:
         void initializeDevice() override;
         void processWork(mpi::work::Work &work,
                          bool flushWriteStream = false) override;
-        std::unique_ptr<networking::Fabric> tcpFabric{nullptr};
-        std::unique_ptr<networking::ReadStream> tcpreadStream{nullptr};
+        // Control channel to the farm, commands go out and their
+        // acknowledgements come back. Tiles and frame ends arrive on the
+        // bulk channel, one port up
+        std::unique_ptr<mpicommon::TCPFabric> tcpFabric{nullptr};
+        std::unique_ptr<mpicommon::TCPFabric> bulkFabric{nullptr};
+        std::unique_ptr<mpicommon::SharedReadStream> tcpreadStream{nullptr};
         std::unique_ptr<networking::WriteStream> tcpwriteStream{nullptr};
         bool tcp_initialized{false};
 
+        // Runs the tiles and frame ends coming from the farm, until the
+        // farm answers the finalize of ~Device or disconnects
+        void receiveLoop();
+        std::thread receiveThread;
+        std::atomic<bool> finalizing{false};
+        std::mutex frames;
+        std::condition_variable condition_frames;
+        int32 framesFinished{0};
+
+        // Reads the control acknowledgements, until the one of the
+        // finalize of ~Device or a disconnect
+        void controlLoop();
+        std::thread controlThread;
+        std::mutex control;
+        // Send times of the commands the farm has not received yet,
+        // oldest first
+        std::deque<std::chrono::steady_clock::time_point> controlSent;
+        uint64 controlAcked{0};
+        std::vector<double> controlLatency;
+
+        // Settings of the next frame, the codec and samples are sent to
+        // the farm when they change
+        QualitySettings nextSettings(DisplayFramebuffer *dfb,
+                                     OSPRenderer _renderer);
+        std::unique_ptr<QualityGovernor> governor;
+        // Codec the farm was told to use
+        bool tilesCompressed{mpicommon::defaultCodec() !=
+                             mpicommon::CODEC_NONE};
+        // spp the application set and the one the farm has, per renderer
+        std::map<int64, int> appSamples;
+        std::map<int64, int> sentSamples;
+        // Sending the settings of the governor, not an interaction
+        bool governing{false};
+        // Objects the application set parameters on since it last
+        // committed them, the governor does not commit those for it
+        std::set<int64> uncommitted;
+        void parameterSet(OSPObject _object);
+        // Farm frame buffer of the wall at 1/scale, tiles coming from it
+        // land in the frame buffer of fb on the head
+        ObjectHandle scaledFrameBuffer(const ObjectHandle &fb,
+                                       DisplayFramebuffer *dfb,
+                                       const int scale);
+        std::map<std::pair<int64, int>, ObjectHandle> scaledFrameBuffers;
+        bool interacting{false};
+
+        // "regionOfInterest" of each frame buffer, normalized, and the
+        // region the farm has for each buffer it renders
+        RegionOfInterest regionOfInterest(OSPFrameBuffer _fb);
+        std::map<int64, vec2f> regionsOfInterest;
+        std::map<int64, RegionOfInterest> sentRegions;
+
+        // Parameters of the perspective cameras and the camera of each
+        // renderer as set, and as last committed. The farm renders with
+        // the committed ones, the display ranks reproject with them too
+        FrameCamera frameCamera(OSPRenderer _renderer);
+        std::map<int64, FrameCamera> cameras;
+        std::map<int64, int64> rendererCameras;
+        std::map<int64, FrameCamera> committedCameras;
+        std::map<int64, int64> committedRendererCameras;
+
+        // Frames sent to the farm and not finished yet, under frames
+        struct FrameRequest
+        {
+          int32 frame;
+          QualitySettings settings;
+          // In wall pixels
+          RegionOfInterest region;
+          std::chrono::steady_clock::time_point sent;
+        };
+        std::deque<FrameRequest> framesPending;
+        std::chrono::steady_clock::time_point lastFinished;
+
+        // Receive thread, bulk channel bytes and time spent forwarding
+        // tiles since the last FrameEnd
+        uint64 receivedBytes{0};
+        uint64 receivedRawBytes{0};
+        double forwardTime{0.0};
+        bool receiving{false};
+        std::chrono::steady_clock::time_point firstReceived;
+        // Receive thread, region of interest of the frame being received
+        int32 focusFrame{0};
+        int focusScale{1};
+        RegionOfInterest focusRegion;
+        bool focusReached{false};
+        std::chrono::steady_clock::time_point focusForwarded;
+        FrameLatency frameLatency;
+
         ObjectHandle wHandle;
       };
     }  // namespace display
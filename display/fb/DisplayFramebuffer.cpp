@@ -26,8 +26,12 @@
    @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
  */
 #include "DisplayFramebuffer.h"
+#include "DisplayFramebuffer_ispc.h"
+#include <display/glDisplay/glDisplay.h>
 #include <ospray/fb/LocalFB.h>
+#include <algorithm>
 #include <thread>
+#include "ospcommon/utility/getEnvVar.h"
 
 template <typename T>
 bool inline inRange(const T &x, const T &lower, const T &upper)
@@ -53,10 +57,6 @@ bool inline tileBelongsTo(const ospcommon::vec2i &tpos,
   return test;
 }
 
-inline int tileID(const ospcommon::vec2i& max,const ospcommon::vec2i& tile) {
-  return (tile.y * max.x) + tile.x;
-}
-
 ospray::dw::display::DisplayFramebuffer::DisplayFramebuffer(
     ObjectHandle &handle,
     const ospcommon::vec2i &size,
@@ -66,13 +66,15 @@ ospray::dw::display::DisplayFramebuffer::DisplayFramebuffer(
     bool hasVarianceBuffer,
     const vec2i &pos,
     const vec2f &ratio,
-    const vec2i &completeScreen)
+    const vec2i &completeScreen,
+    const int tileSize)
     : mpi::messaging::MessageHandler(handle),
       ospray::FrameBuffer(size,
                           colorBufferFormat,
                           hasDepthBuffer,
                           hasAccumBuffer,
                           hasVarianceBuffer),
+      tileSize(tileSize),
       pos(pos),
       ratio(ratio),
       completeScreen(completeScreen)
@@ -80,106 +82,782 @@ ospray::dw::display::DisplayFramebuffer::DisplayFramebuffer(
   Assert(size.x > 0);
   Assert(size.y > 0);
 
-  switch (colorBufferFormat) {
-  case OSP_FB_NONE:
-    colorBuffer = nullptr;
-    break;
-  case OSP_FB_RGBA8:
-  case OSP_FB_SRGBA:
-    colorBuffer = (uint32 *)alignedMalloc(sizeof(uint32) * size.x * size.y);
-    break;
-  case OSP_FB_RGBA32F:
-    colorBuffer = (vec4f *)alignedMalloc(sizeof(vec4f) * size.x * size.y);
-    break;
+  useRMA = utility::getEnvVar<int>("DW_USE_RMA").value_or(0);
+
+  // Display ranks fill one buffer while the previous ones are presented,
+  // puts from the head only have the one buffer the window exposes
+  framesInFlight = minInRange(
+      utility::getEnvVar<int>("DW_FRAMES_IN_FLIGHT").value_or(2), 1, 3);
+  const int numBuffers =
+      (mpicommon::IamAWorker() && !useRMA) ? framesInFlight : 1;
+  for (int b = 0; b < numBuffers; b++) {
+    switch (colorBufferFormat) {
+    case OSP_FB_NONE:
+      colorBuffers.push_back(nullptr);
+      break;
+    case OSP_FB_RGBA8:
+    case OSP_FB_SRGBA:
+      colorBuffers.push_back(
+          (uint32 *)alignedMalloc(sizeof(uint32) * size.x * size.y));
+      break;
+    case OSP_FB_RGBA32F:
+      colorBuffers.push_back(
+          (vec4f *)alignedMalloc(sizeof(vec4f) * size.x * size.y));
+      break;
+    }
   }
+  for (auto buffer : colorBuffers)
+    if (buffer)
+      std::memset(buffer, 0, size.x * size.y * sizeOfType(colorBufferFormat));
+  colorBuffer = colorBuffers[0];
 
-  maxTiles = ospcommon::divRoundUp(completeScreen,ospcommon::vec2i(TILE_SIZE));
+  reproject = hasDepthBuffer && colorBuffer && colorBuffers.size() >= 2;
+  if (reproject) {
+    for (int b = 0; b < numBuffers; b++) {
+      float *depth = (float *)alignedMalloc(sizeof(float) * size.x * size.y);
+      std::fill(depth, depth + size.x * size.y, float(inf));
+      depthBuffers.push_back(depth);
+    }
+    bufferFrames.assign(numBuffers, 0);
+    bufferCameras.resize(numBuffers);
+  }
+
+  // The head sends the present record at the deadline, the display ranks
+  // measure against it how late the tiles after the record are
+  presentDeadline =
+      utility::getEnvVar<int>("DW_PRESENT_DEADLINE_MS").value_or(0);
+  deadlines.resize(colorBuffers.size());
+
+  if (mpicommon::IamTheMaster())
+    batcher = make_unique<TileBatcher>(handle, tileSize, hasDepthBuffer);
+
+  // Collective over the head and the display ranks, the head exposes nothing
+  if (useRMA) {
+    const bool expose = mpicommon::IamAWorker() && colorBuffer;
+    MPI_CALL(Win_create(expose ? colorBuffer : nullptr,
+                        expose ? size.x * size.y * sizeOfType(colorBufferFormat) : 0,
+                        1,
+                        MPI_INFO_NULL,
+                        mpicommon::world.comm,
+                        &window));
+    MPI_CALL(Win_lock_all(0, window));
+  }
+
+  // Puts from the head always land at full scale
+  grids.resize(useRMA ? 1 : numScaleLevels);
+  for (int level = 0; level < grids.size(); level++)
+    buildGrid(grids[level], 1 << level);
+  grid = &grids[0];
+
+  // Collective too, one barrier per frame once the display ranks showed it
+  MPI_CALL(Comm_dup(mpicommon::world.comm, &frameComm));
+  frameRequests.assign(framesInFlight, MPI_REQUEST_NULL);
+  if (mpicommon::IamAWorker() && !useRMA)
+    presenter = std::thread([&] { presentLoop(); });
 
-  for (int y = 0; y < completeScreen.y; y += TILE_SIZE) {
-    for (int x = 0; x < completeScreen.x; x += TILE_SIZE) {
+  // Stays on, tiles of the next frame may arrive while this one is shown
+  mpi::messaging::enableAsyncMessaging();
+}
+
+ospray::dw::display::DisplayFramebuffer::~DisplayFramebuffer()
+{
+  if (presenter.joinable()) {
+    framesDone.push(FramePresent{-1, false, false});
+    presenter.join();
+  }
+  MPI_CALL(Waitall(
+      frameRequests.size(), frameRequests.data(), MPI_STATUSES_IGNORE));
+  MPI_CALL(Comm_free(&frameComm));
+  if (window != MPI_WIN_NULL) {
+    MPI_CALL(Win_unlock_all(window));
+    MPI_CALL(Win_free(&window));
+  }
+  for (auto &type : rowsTypes)
+    MPI_CALL(Type_free(&type.second));
+  for (auto buffer : colorBuffers)
+    alignedFree(buffer);
+  for (auto depth : depthBuffers)
+    alignedFree(depth);
+  for (auto &grid : grids)
+    alignedFree(grid.pixels);
+}
+
+void ospray::dw::display::DisplayFramebuffer::buildGrid(TileGrid &grid,
+                                                        const int scale)
+{
+  // The head gets every tile, a display rank the ones it shows. Below
+  // full scale that is the footprint it upscales from
+  const vec2i wall = divRoundUp(completeScreen, vec2i(scale));
+  grid.scale       = scale;
+  grid.maxTiles    = divRoundUp(wall, vec2i(tileSize));
+  grid.footprint   = scale == 1 ? box2i(pos, pos + size)
+                              : scaledFootprint(pos, size, completeScreen, scale);
+
+  const int numTiles = grid.maxTiles.x * grid.maxTiles.y;
+  grid.tilesRequired.assign((numTiles + 63) / 64, 0);
+  grid.tilesFrame.reset(new std::atomic<int>[numTiles]);
+  grid.pixelsFrame.reset(new std::atomic<int>[numTiles]);
+  for (int y = 0; y < wall.y; y += tileSize) {
+    for (int x = 0; x < wall.x; x += tileSize) {
       vec2i p(x, y);
-      if (mpicommon::IamTheMaster())
-        tilesRequired.insert(tileID(maxTiles,p));
-      else if (tileBelongsTo(p, vec2i(TILE_SIZE), pos, size))
-        tilesRequired.insert(tileID(maxTiles,p));
+      const int t       = tileIndex(grid, p);
+      grid.tilesFrame[t] = -1;
+      grid.pixelsFrame[t] = -1;
+      if (mpicommon::IamTheMaster() ||
+          tileBelongsTo(
+              p, vec2i(tileSize), grid.footprint.lower, grid.footprint.size())) {
+        grid.tilesRequired[t >> 6] |= uint64_t(1) << (t & 63);
+        grid.numTilesRequired++;
+      }
     }
   }
+
+  const size_t pixelSize = sizeOfType(colorBufferFormat);
+  if (scale > 1 && mpicommon::IamAWorker() && pixelSize) {
+    const size_t bytes =
+        grid.footprint.size().x * grid.footprint.size().y * pixelSize;
+    grid.pixels = alignedMalloc(bytes);
+    std::memset(grid.pixels, 0, bytes);
+  }
 }
 
-ospray::dw::display::DisplayFramebuffer::~DisplayFramebuffer()
+void ospray::dw::display::DisplayFramebuffer::setFrameScale(const int32 frame,
+                                                            const int scale)
+{
+  std::lock_guard<std::mutex> lock(staging);
+  frameScales[frame] = scale;
+}
+
+void ospray::dw::display::DisplayFramebuffer::setFrameCamera(
+    const int32 frame, const FrameCamera &camera)
 {
-  alignedFree(colorBuffer);
+  if (!reproject)
+    return;
+  std::lock_guard<std::mutex> lock(staging);
+  frameCameras[frame] = camera;
 }
 
 bool ospray::dw::display::DisplayFramebuffer::isFrameReady()
 {
-  return (frameeDone);
+  return countdown.isDone();
 }
 
 bool ospray::dw::display::DisplayFramebuffer::setNumTilesDone(
     const vec2i &tileDone)
 {
-  std::lock_guard<std::mutex> lock(tilesDone_mutex);
-  if(tilesMissing.find(tileID(maxTiles,tileDone)) != tilesMissing.end()) {
-      tilesMissing.erase(tileID(maxTiles, tileDone));
+  return setNumTilesDone(tileDone, currentFrame);
+}
+
+bool ospray::dw::display::DisplayFramebuffer::setNumTilesDone(
+    const vec2i &tileDone, const int32 frame)
+{
+  return setNumTilesDone(*grid, tileDone, frame);
+}
+
+bool ospray::dw::display::DisplayFramebuffer::setNumTilesDone(
+    TileGrid &grid, const vec2i &tileDone, const int32 frame)
+{
+  // Past a deadline the next frame starts while tiles of this one are
+  // still on their way. Those go to patchLateRegion, but one that raced
+  // beginFrame ends up here: the countdown only takes tiles of its own
+  // frame, and a duplicate finds its frame in tilesFrame already
+  if (!grid.arrive(tileIndex(grid, tileDone), frame))
+    return isFrameReady();
+
+  countdown.arrive(frame);
+  return isFrameReady();
+}
+
+bool ospray::dw::display::DisplayFramebuffer::waitUntilFrameDone()
+{
+  // Every panel shows or skips the frame as the head says. Its record
+  // comes behind the tiles of the frame, or at the deadline of the head
+  // with the tiles that made it
+  const int32 frame = currentFrame;
+  {
+    std::unique_lock<std::mutex> lock(staging);
+    condition_recorded.wait(lock,
+                            [&] { return presentRecords.count(frame); });
+    frameShown = presentRecords[frame];
+    presentRecords.erase(presentRecords.begin(),
+                         presentRecords.upper_bound(frame));
   }
-  frameeDone = tilesMissing.empty();
-  if (frameeDone) {
-      condition_done.notify_all();
+  if (!frameShown || countdown.isDone())
+    return true;
+  keepMissingTiles();
+  return false;
+}
+
+void ospray::dw::display::DisplayFramebuffer::keepMissingTiles()
+{
+  // Copy the missing tiles from the frame before, below full scale the
+  // grid buffer still has them. Late tiles patch under presenting, the
+  // ones already there are not copied over
+  const int32 frame = currentFrame;
+  const TileGrid &current = *grid;
+  std::lock_guard<std::mutex> lock(presenting);
+  for (int t = 0; t < current.maxTiles.x * current.maxTiles.y; t++) {
+    if (!tileRequired(current, t) || current.tilesFrame[t] == frame)
+      continue;
+    tilesMissed++;
+    // A reprojected frame already has the tile through its own camera
+    if (current.scale == 1 && !frameReprojected)
+      keepTile(t);
   }
-  return frameeDone;
 }
 
-void ospray::dw::display::DisplayFramebuffer::waitUntilFrameDone()
+void ospray::dw::display::DisplayFramebuffer::keepTile(const int t)
 {
-  std::unique_lock<std::mutex> lock(done);
-  condition_done.wait(lock, [&] { return isFrameReady(); });
+  const size_t numBuffer = colorBuffers.size();
+  if (numBuffer < 2 || !colorBuffer)
+    return;
+  // The frame before may have been dropped or missed the tile, the last
+  // pixels are in an older buffer then. Once that buffer is reused they
+  // are gone and the tile shows what it had until the farm refreshes it
+  TileGrid &full     = grids[0];
+  const int32 frame  = currentFrame;
+  const int32 source = full.pixelsFrame[t];
+  if (source < 0 || source == frame || frame - source >= int32(numBuffer))
+    return;
+  const byte_t *previous = (const byte_t *)colorBuffers[source % numBuffer];
+  byte_t *color          = (byte_t *)colorBuffer;
+  const size_t pixelSize = sizeOfType(colorBufferFormat);
+  const box2i screen(pos, pos + size);
+  const vec2i coords =
+      vec2i(t % full.maxTiles.x, t / full.maxTiles.x) * tileSize;
+  const box2i tile(max(coords, screen.lower),
+                   min(coords + vec2i(tileSize), screen.upper));
+  const size_t rowSize = (tile.upper.x - tile.lower.x) * pixelSize;
+  for (int y = tile.lower.y; y < tile.upper.y; y++) {
+    const size_t offset =
+        ((y - pos.y) * size.x + (tile.lower.x - pos.x)) * pixelSize;
+    std::memcpy(color + offset, previous + offset, rowSize);
+  }
+  if (depthBuffer) {
+    const float *previousDepth = depthBuffers[source % numBuffer];
+    for (int y = tile.lower.y; y < tile.upper.y; y++) {
+      const size_t offset = (y - pos.y) * size.x + (tile.lower.x - pos.x);
+      std::memcpy(depthBuffer + offset,
+                  previousDepth + offset,
+                  (tile.upper.x - tile.lower.x) * sizeof(float));
+    }
+  }
+  full.setPixelsFrame(t, frame);
 }
 
-void ospray::dw::display::DisplayFramebuffer::incoming(
-    const std::shared_ptr<maml::Message> &message)
+void ospray::dw::display::DisplayFramebuffer::patchLateRegion(
+    TileRegion *region)
 {
-  while (!frameActive)
-    ;
-  auto tile = (TileData *)message->data;
+  // A frame below full scale is only complete once upscaled
+  const int32 frame = currentFrame;
+  if (region->scale != 1 || region->frame > frame ||
+      frame - region->frame >= int32(colorBuffers.size()))
+    return;
 
-  if(tilesRequired.find(tileID(maxTiles,tile->coords)) == tilesRequired.end()) {
-      std::cout << "[" << mpicommon::worker.rank << " ] " << tile->coords << " x " << pos  << " : " << (pos + size)  << " : " << tilesMissing.size() << std::endl;
+  // The presenter may be copying that buffer right now. A frame it
+  // already showed stays as it was on the panel, every panel has to show
+  // the same frames for the barrier in glDisplay::loadFrame, so the patch
+  // only reaches the screen through the deadline copy of a later frame
+  byte_t *color = (byte_t *)colorBuffers[region->frame % colorBuffers.size()];
+  {
+    std::lock_guard<std::mutex> lock(presenting);
+    switch (region->type) {
+    case OSP_FB_RGBA8:
+    case OSP_FB_SRGBA:
+      blit<OSP_FB_RGBA8>(region, color);
+      break;
+    case OSP_FB_RGBA32F:
+      blit<OSP_FB_RGBA32F>(region, color);
+      break;
+    default:
       return;
+    }
+    if (region->hasDepth && reproject)
+      blitDepth(region, depthBuffers[region->frame % depthBuffers.size()]);
+    // keepMissingTiles of the current frame leaves the tile alone
+    grids[0].arrive(tileIndex(grids[0], region->coords), region->frame);
+  }
+  grids[0].setPixelsFrame(tileIndex(grids[0], region->coords), region->frame);
+  tileLate(region->frame);
+}
+
+void ospray::dw::display::DisplayFramebuffer::tileLate(const int32 frame)
+{
+  auto late = std::chrono::high_resolution_clock::now() -
+              deadlines[frame % deadlines.size()];
+  tilesLate++;
+  lateMicroseconds +=
+      std::chrono::duration_cast<std::chrono::microseconds>(late).count();
+}
+
+bool ospray::dw::display::DisplayFramebuffer::stageRegion(
+    const TileRegion *region)
+{
+  std::lock_guard<std::mutex> lock(staging);
+  if (region->frame <= currentFrame)
+    return false;
+  auto &staged = stagedRegions[region->frame];
+  staged.insert(staged.end(),
+                (const byte_t *)region,
+                (const byte_t *)region + region->byteSize());
+  return true;
+}
+
+void ospray::dw::display::DisplayFramebuffer::accumRegion(TileRegion *region)
+{
+  // The region says its scale, the grid of the frame may already move on
+  auto &target = gridOf(region->scale);
+  if (!tileRequired(target, tileIndex(target, region->coords))) {
+    std::cout << "[" << mpicommon::worker.rank << " ] " << region->coords
+              << " x " << pos << " : " << (pos + size) << " : "
+              << countdown.remaining() << std::endl;
+    return;
   }
 
-  switch (tile->type) {
+  switch (region->type) {
   case OSP_FB_RGBA8:
-    accum((TilePixels<OSP_FB_RGBA8> *)tile);
+  case OSP_FB_SRGBA:
+    accum<OSP_FB_RGBA8>(target, region);
     break;
   case OSP_FB_RGBA32F:
-    accum((TilePixels<OSP_FB_RGBA32F> *)tile);
+    accum<OSP_FB_RGBA32F>(target, region);
     break;
   case OSP_FB_NONE:
-    accum((TilePixels<OSP_FB_NONE> *)tile);
+    // Unchanged tile, an earlier buffer has its pixels
+    if (target.scale == 1)
+      keepTile(tileIndex(target, region->coords));
+    setNumTilesDone(target, region->coords, region->frame);
     break;
   }
+}
 
+void ospray::dw::display::DisplayFramebuffer::accumRegions(
+    const std::vector<TileRegion *> &regions, size_t bytes)
+{
+  // Regions never overlap, whole regions go to different cores. A few
+  // small ones are cheaper to copy than to schedule
+  static constexpr size_t inlineBytes = 64 * 1024;
+  if (regions.size() < 2 || bytes < inlineBytes) {
+    for (auto region : regions)
+      accumRegion(region);
+    return;
+  }
+  tasking::parallel_for(regions.size(),
+                        [&](const int r) { accumRegion(regions[r]); });
+}
+
+void ospray::dw::display::DisplayFramebuffer::incoming(
+    const std::shared_ptr<maml::Message> &message)
+{
+  // The head node only hears back credits from the display ranks
+  if (mpicommon::IamTheMaster()) {
+    auto credit = (CreditMessage *)message->data;
+    batcher->returnCredits(credit->rank, credit->bytes);
+    return;
+  }
+
+  // Batch of regions from the head node, one after the other
+  thread_local std::vector<TileRegion *> current;
+  current.clear();
+  byte_t *next = message->data;
+  byte_t *end  = message->data + message->size;
+  while (next < end) {
+    auto region = (TileRegion *)next;
+    next += region->byteSize();
+
+    // The regions ahead of a present record made it in time
+    if (region->isFramePresent()) {
+      accumRegions(current, message->size);
+      current.clear();
+      presentRecord(region);
+      continue;
+    }
+    // Early regions wait for their frame, the ones of a frame whose
+    // present record came already are late and patch its buffer
+    if (region->frame > currentFrame && stageRegion(region))
+      continue;
+    if (region->frame != currentFrame || region->frame <= recordedFrame) {
+      patchLateRegion(region);
+      continue;
+    }
+    current.push_back(region);
+  }
+  accumRegions(current, message->size);
+
+  CreditMessage credit;
+  credit.rank  = mpicommon::worker.rank;
+  credit.bytes = message->size;
+  auto reply   = std::make_shared<maml::Message>(&credit, sizeof(credit));
+  mpi::messaging::sendTo(mpicommon::masterRank(), myId, reply);
 }
 
 void ospray::dw::display::DisplayFramebuffer::beginFrame()
 {
-  frameeDone = false;
-  mpi::messaging::enableAsyncMessaging();
-  std::lock_guard<std::mutex> lock(tilesDone_mutex);
-  tilesMissing = tilesRequired;
-  frameActive = true;
+  const int32 frame = currentFrame + 1;
+  {
+    std::lock_guard<std::mutex> lock(staging);
+    auto scale = frameScales.find(frame);
+    grid       = &gridOf(scale != frameScales.end() ? scale->second : 1);
+    frameScales.erase(frameScales.begin(), frameScales.upper_bound(frame));
+    auto camera = frameCameras.find(frame);
+    frameCamera = camera != frameCameras.end() ? camera->second : FrameCamera();
+    frameCameras.erase(frameCameras.begin(), frameCameras.upper_bound(frame));
+  }
+  countdown.reset(frame, grid->numTilesRequired);
+
+  // The buffer of this frame is free once the frame before it was shown
+  if (presenter.joinable()) {
+    std::unique_lock<std::mutex> lock(presenting);
+    condition_presented.wait(lock, [&] {
+      return frame - presentedFrame <= int32(colorBuffers.size());
+    });
+  }
+  colorBuffer = colorBuffers[frame % colorBuffers.size()];
+
+  // Before currentFrame moves, no tile of the frame lands in it yet
+  if (reproject) {
+    depthBuffer      = depthBuffers[frame % depthBuffers.size()];
+    frameReprojected = reprojectFrame(frame);
+  }
+
+#ifdef DW_MEASURE_TIMES
+  if (mpicommon::IamAWorker() && blitStats.bytes) {
+    std::cout << "[" << mpicommon::worker.rank << "] Frame " << currentFrame
+              << " blit : " << blitStats.gbs() << "GB/s"
+              << " convert : " << convertStats.gbs() << "GB/s"
+              << " upscale : " << upscaleStats.gbs() << "GB/s"
+              << " reproject : " << reprojectStats.gbs() << "GB/s"
+              << std::endl;
+    blitStats.reset();
+    convertStats.reset();
+    upscaleStats.reset();
+    reprojectStats.reset();
+  }
+#endif
+
+  if (presentDeadline > 0) {
+#ifdef DW_MEASURE_TIMES
+    if (tilesMissed || tilesLate) {
+      std::cout << "[" << mpicommon::worker.rank << "] Frame " << currentFrame
+                << " missed : " << tilesMissed << " late : " << tilesLate
+                << " mean lateness : "
+                << (tilesLate ? lateMicroseconds / tilesLate / 1000.0 : 0.0)
+                << "ms" << std::endl;
+    }
+    tilesMissed = tilesLate = 0;
+    lateMicroseconds        = 0;
+#endif
+    deadlines[frame % deadlines.size()] =
+        std::chrono::high_resolution_clock::now() +
+        std::chrono::milliseconds(presentDeadline);
+  }
+
+  std::vector<byte_t> early;
+  {
+    std::lock_guard<std::mutex> lock(staging);
+    currentFrame++;
+    auto staged = stagedRegions.find(currentFrame);
+    if (staged != stagedRegions.end())
+      early.swap(staged->second);
+    stagedRegions.erase(stagedRegions.begin(),
+                        stagedRegions.upper_bound(currentFrame));
+  }
+
+  std::vector<TileRegion *> regions;
+  byte_t *next = early.data();
+  byte_t *end  = early.data() + early.size();
+  while (next < end) {
+    regions.push_back((TileRegion *)next);
+    next += regions.back()->byteSize();
+  }
+  accumRegions(regions, early.size());
 }
 
 float ospray::dw::display::DisplayFramebuffer::endFrame(
     const float errorThreshold)
 {
-  mpi::messaging::disableAsyncMessaging();
-  frameActive = false;
+  if (useRMA)
+    return 0.f;
+  if (presenter.joinable()) {
+    if (grid->scale > 1 && frameShown)
+      upscaleFrame();
+    if (reproject) {
+      // Only full scale frames every panel showed are reprojected, the
+      // head decided for all of them
+      const size_t b   = currentFrame % bufferFrames.size();
+      bufferFrames[b]  = (grid->scale == 1 && frameShown) ? currentFrame : 0;
+      bufferCameras[b] = frameCamera;
+    }
+    framesDone.push(FramePresent{currentFrame, frameShown, false});
+  } else
+    frameInFlight(currentFrame);
+  return 0.f;
+}
+
+void ospray::dw::display::DisplayFramebuffer::upscaleFrame()
+{
+  const TileGrid &current = *grid;
+  if (!current.pixels)
+    return;
+  const vec2i lower  = current.footprint.lower;
+  const vec2i extent = current.footprint.size();
+  // Rows of the screen are independent, blocks of them go to different cores
+  static constexpr int blockRows = 32;
+  const int numBlocks            = (size.y + blockRows - 1) / blockRows;
+  KernelTimer timer(upscaleStats,
+                    size.x * size.y * sizeOfType(colorBufferFormat));
+  tasking::parallel_for(numBlocks, [&](const int block) {
+    const int y0 = block * blockRows;
+    const int y1 = std::min(y0 + blockRows, size.y);
+    if (colorBufferFormat == OSP_FB_RGBA32F) {
+      ispc::DisplayFramebuffer_upscaleRGBA32F((const float *)current.pixels,
+                                              lower.x,
+                                              lower.y,
+                                              extent.x,
+                                              extent.y,
+                                              current.scale,
+                                              (float *)colorBuffer,
+                                              pos.x,
+                                              pos.y,
+                                              size.x,
+                                              y0,
+                                              y1);
+    } else {
+      ispc::DisplayFramebuffer_upscaleRGBA8((const uint32 *)current.pixels,
+                                            lower.x,
+                                            lower.y,
+                                            extent.x,
+                                            extent.y,
+                                            current.scale,
+                                            (uint32 *)colorBuffer,
+                                            pos.x,
+                                            pos.y,
+                                            size.x,
+                                            y0,
+                                            y1);
+    }
+  });
+}
+
+bool ospray::dw::display::DisplayFramebuffer::reprojectFrame(
+    const int32 frame)
+{
+  const size_t source     = (frame - 1) % colorBuffers.size();
+  const FrameCamera &last = bufferCameras[source];
+  if (bufferFrames[source] != frame - 1 || !last.valid || !frameCamera.valid ||
+      last == frameCamera)
+    return false;
+
+  float from[12], to[12];
+  last.basis(from);
+  frameCamera.basis(to);
+  const void *color  = colorBuffers[source];
+  const float *depth = depthBuffers[source];
+  // Rows of the screen are independent, blocks of them go to different cores
+  static constexpr int blockRows = 32;
+  const int numBlocks            = (size.y + blockRows - 1) / blockRows;
+  KernelTimer timer(reprojectStats,
+                    size.x * size.y *
+                        (sizeOfType(colorBufferFormat) + sizeof(float)));
+  tasking::parallel_for(numBlocks, [&](const int block) {
+    const int y0 = block * blockRows;
+    const int y1 = std::min(y0 + blockRows, size.y);
+    if (colorBufferFormat == OSP_FB_RGBA32F) {
+      ispc::DisplayFramebuffer_reprojectRGBA32F((const float *)color,
+                                                depth,
+                                                (float *)colorBuffer,
+                                                depthBuffer,
+                                                size.x,
+                                                size.y,
+                                                pos.x,
+                                                pos.y,
+                                                completeScreen.x,
+                                                completeScreen.y,
+                                                from,
+                                                to,
+                                                y0,
+                                                y1);
+    } else {
+      ispc::DisplayFramebuffer_reprojectRGBA8((const uint32 *)color,
+                                              depth,
+                                              (uint32 *)colorBuffer,
+                                              depthBuffer,
+                                              size.x,
+                                              size.y,
+                                              pos.x,
+                                              pos.y,
+                                              completeScreen.x,
+                                              completeScreen.y,
+                                              from,
+                                              to,
+                                              y0,
+                                              y1);
+    }
+  });
+
+  // Tiles of the frame blit into colorBuffer once currentFrame moves, the
+  // presenter shows the preview from a copy taken before that
+  if (presenter.joinable()) {
+    {
+      std::unique_lock<std::mutex> lock(presenting);
+      condition_presented.wait(lock, [&] { return !previewPending; });
+      copyForPresent(colorBuffer, previewPixels);
+      previewPending = true;
+    }
+    framesDone.push(FramePresent{frame, true, true});
+  }
+  return true;
+}
+
+void ospray::dw::display::DisplayFramebuffer::downsampleTile(
+    const vec2i &coords, const byte_t *pixels)
+{
+  // Both are no-ops for the part of the tile outside this buffer. Tiles
+  // of a lower scale cover scale times more of the wall
+  const vec2i local = coords - pos;
+  const vec2f ratio = this->ratio * float(grid->scale);
+  if (colorBufferFormat == OSP_FB_RGBA32F) {
+    KernelTimer timer(downsampleStats,
+                      tileSize * tileSize * ratio.x * ratio.y *
+                          sizeof(vec4f));
+    ispc::DisplayFramebuffer_downsampleRGBA32F((const float *)pixels,
+                                               local.x,
+                                               local.y,
+                                               tileSize,
+                                               ratio.x,
+                                               ratio.y,
+                                               (float *)colorBuffer,
+                                               size.x,
+                                               size.y);
+  } else {
+    KernelTimer timer(downsampleStats,
+                      tileSize * tileSize * ratio.x * ratio.y *
+                          sizeof(uint32));
+    ispc::DisplayFramebuffer_downsampleRGBA8((const uint32 *)pixels,
+                                             local.x,
+                                             local.y,
+                                             tileSize,
+                                             ratio.x,
+                                             ratio.y,
+                                             (uint32 *)colorBuffer,
+                                             size.x,
+                                             size.y);
+  }
+}
+
+void ospray::dw::display::DisplayFramebuffer::openFrame(const int32 frame)
+{
+  if (frame > currentFrame)
+    beginFrame();
+}
+
+void ospray::dw::display::DisplayFramebuffer::presentRecord(
+    const TileRegion *record)
+{
+  // Records come in frame order, a frame the display rank has not
+  // started yet keeps its record until it waits for it
+  {
+    std::lock_guard<std::mutex> lock(staging);
+    presentRecords[record->frame] = record->showFrame();
+    recordedFrame                 = record->frame;
+  }
+  condition_recorded.notify_all();
+}
+
+void ospray::dw::display::DisplayFramebuffer::presentFrame(const int32 frame,
+                                                           const bool show)
+{
+  // Past the deadline the record went out already, the tiles batched
+  // since still go
+  if (frame > recordedFrame) {
+    batcher->presentFrame(frame, show);
+    recordedFrame = frame;
+  }
+  batcher->flush();
+}
+
+void ospray::dw::display::DisplayFramebuffer::presentAtDeadline()
+{
+  // Checked with every tile forwarded, a frame whose tiles stall is shown
+  // with the next tile or its frame end
+  const int32 frame = currentFrame;
+  if (presentDeadline <= 0 || useRMA || frame <= recordedFrame)
+    return;
+  if (std::chrono::high_resolution_clock::now() <
+      deadlines[frame % deadlines.size()])
+    return;
+  presentFrame(frame, true);
+}
+
+void ospray::dw::display::DisplayFramebuffer::frameInFlight(const int32 frame)
+{
+  // Waiting on the slot bounds the head to framesInFlight frames ahead of
+  // the slowest panel
+  auto &request    = frameRequests[frame % frameRequests.size()];
+  const auto start = std::chrono::steady_clock::now();
+  MPI_CALL(Wait(&request, MPI_STATUS_IGNORE));
+  presentWaitMicroseconds +=
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count();
+  MPI_CALL(Ibarrier(frameComm, &request));
+}
+
+void ospray::dw::display::DisplayFramebuffer::copyForPresent(
+    const void *color, std::vector<uint32> &pixels)
+{
+  pixels.resize(size.x * size.y);
+  // glDisplay only takes RGBA8
+  if (colorBufferFormat == OSP_FB_RGBA32F) {
+    KernelTimer timer(convertStats, pixels.size() * sizeof(uint32));
+    ispc::DisplayFramebuffer_convertRGBA32FToRGBA8(
+        (const float *)color, pixels.data(), size.x * size.y, false);
+  } else
+    std::memcpy(pixels.data(), color, pixels.size() * sizeof(uint32));
+}
+
+void ospray::dw::display::DisplayFramebuffer::presentLoop()
+{
+  while (true) {
+    const auto next   = framesDone.pop();
+    const int32 frame = next.frame;
+    if (frame < 0)
+      break;
+    // A dropped frame keeps the previous one on screen
+    if (next.show) {
+      // Late tiles patch older buffers under presenting, the frame is
+      // shown from a copy taken under it too. A preview was copied before
+      // the tiles of its frame started landing
+      {
+        std::lock_guard<std::mutex> lock(presenting);
+        if (next.preview) {
+          std::swap(presentPixels, previewPixels);
+          previewPending = false;
+        } else
+          copyForPresent(colorBuffers[frame % colorBuffers.size()],
+                         presentPixels);
+      }
+      if (next.preview)
+        condition_presented.notify_all();
+      dw::glDisplay::loadFrame((const byte_t *)presentPixels.data(), size);
+    }
+    // The frame itself follows once its tiles are in
+    if (next.preview)
+      continue;
+    {
+      std::lock_guard<std::mutex> lock(presenting);
+      presentedFrame = frame;
+    }
+    condition_presented.notify_all();
+    frameInFlight(frame);
+  }
 }
 const void *ospray::dw::display::DisplayFramebuffer::mapDepthBuffer()
 {
-  return nullptr;
+  if (!depthBuffer)
+    return nullptr;
+  this->refInc();
+  return (const void *)depthBuffer;
 }
 const void *ospray::dw::display::DisplayFramebuffer::mapColorBuffer()
 {
@@ -188,7 +866,8 @@ const void *ospray::dw::display::DisplayFramebuffer::mapColorBuffer()
 }
 void ospray::dw::display::DisplayFramebuffer::unmap(const void *mappedMem)
 {
-  if (!(mappedMem == colorBuffer)) {
+  if (!(mappedMem == colorBuffer ||
+        (depthBuffer && mappedMem == depthBuffer))) {
     throw std::runtime_error(
         "ERROR: unmapping a pointer not created by "
         "OSPRay!");
@@ -213,10 +892,83 @@ float ospray::dw::display::DisplayFramebuffer::tileError(
 }
 int ospray::dw::display::DisplayFramebuffer::getTotalTiles() const
 {
-  return tilesRequired.size();
+  return grid->numTilesRequired;
+}
+
+MPI_Datatype ospray::dw::display::DisplayFramebuffer::rowsType(int rows,
+                                                             int rowSize,
+                                                             int stride)
+{
+  auto key  = std::make_tuple(rows, rowSize, stride);
+  auto type = rowsTypes.find(key);
+  if (type != rowsTypes.end())
+    return type->second;
+
+  MPI_Datatype rowsType;
+  MPI_CALL(Type_vector(rows, rowSize, stride, MPI_BYTE, &rowsType));
+  MPI_CALL(Type_commit(&rowsType));
+  rowsTypes[key] = rowsType;
+  return rowsType;
+}
+
+void ospray::dw::display::DisplayFramebuffer::putRegion(
+    int rank,
+    const byte_t *tilePixels,
+    size_t pixelSize,
+    const vec2i &coords,
+    const box2i &region,
+    const vec2i &screenPos,
+    const vec2i &screenSize)
+{
+  const vec2i extent = region.size();
+  const vec2i origin = region.lower - coords;
+  const vec2i target = region.lower - screenPos;
+  const int rowSize  = extent.x * pixelSize;
+
+  MPI_CALL(Put(tilePixels + (origin.y * tileSize + origin.x) * pixelSize,
+               1,
+               rowsType(extent.y, rowSize, tileSize * pixelSize),
+               mpicommon::globalRankFromWorkerRank(rank),
+               (target.y * screenSize.x + target.x) * pixelSize,
+               1,
+               rowsType(extent.y, rowSize, screenSize.x * pixelSize),
+               window));
+  // The tile lives on the stack of the caller, only local completion here
+  MPI_CALL(Win_flush_local(mpicommon::globalRankFromWorkerRank(rank), window));
+}
+
+void ospray::dw::display::DisplayFramebuffer::flushRegions()
+{
+  MPI_CALL(Win_flush_all(window));
+}
+
+void ospray::dw::display::DisplayFramebuffer::syncRegions()
+{
+  MPI_CALL(Win_sync(window));
+}
+
+void ospray::dw::display::DisplayFramebuffer::setTileMask(
+    const vec2i &numTiles, const std::vector<byte_t> &mask)
+{
+  // The mask is for the full scale frames
+  auto &full = grids[0];
+  if (numTiles != full.maxTiles)
+    throw std::runtime_error("Tile mask does not match the frame buffer");
+  // Tiles behind the bezels are never sent, do not wait for them
+  for (int t = 0; t < numTiles.x * numTiles.y; t++) {
+    if (!mask[t] && tileRequired(full, t)) {
+      full.tilesRequired[t >> 6] &= ~(uint64_t(1) << (t & 63));
+      full.numTilesRequired--;
+    }
+  }
 }
 
 std::set<int> ospray::dw::display::DisplayFramebuffer::diff()
 {
-  return tilesMissing;
+  std::set<int> missing;
+  const TileGrid &current = *grid;
+  for (int t = 0; t < current.maxTiles.x * current.maxTiles.y; t++)
+    if (tileRequired(current, t) && current.tilesFrame[t] != currentFrame)
+      missing.insert(t);
+  return missing;
 }
\ No newline at end of file
@@ -27,13 +27,26 @@
  */
 #pragma once
 
+#include <common/work/WorkQueue.h>
+#include <display/glDisplay/WallConfig.h>
 #include <mpi/common/Messaging.h>
 #include <ospray/fb/LocalFB.h>
+#include "FrameCamera.h"
+#include "FrameCountdown.h"
+#include "TileBatcher.h"
+#include "ospcommon/box.h"
 #include "ospcommon/tasking/parallel_for.h"
 
 #include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 namespace ospray {
   namespace dw {
@@ -75,31 +88,256 @@ namespace ospray {
         return sizeof(vec4f);
       }
 
+      inline size_t sizeOfType(const OSPFrameBufferFormat &type)
+      {
+        switch (type) {
+        case OSP_FB_RGBA8:
+        case OSP_FB_SRGBA:
+          return sizeOfType<OSP_FB_RGBA8>();
+        case OSP_FB_RGBA32F:
+          return sizeOfType<OSP_FB_RGBA32F>();
+        default:
+          return 0;
+        }
+      }
+
       struct TileData
       {
         OSPFrameBufferFormat type;
         vec2i coords;
+        // Frame the tile belongs to, stamped by the head node
+        int32 frame{0};
+        // The frame was rendered at 1/scale, coords are in its pixels
+        int32 scale{1};
 
         TileData(const OSPFrameBufferFormat &type = OSP_FB_NONE,
-                 const vec2i &coords              = vec2i(0))
-            : type(type), coords(coords){};
+                 const vec2i &coords              = vec2i(0),
+                 const int32 frame                = 0,
+                 const int32 scale                = 1)
+            : type(type), coords(coords), frame(frame), scale(scale){};
       };
 
+      /*! Pixels of a full tile, a view into the message it came in */
       template <OSPFrameBufferFormat FBType>
       struct TilePixels : public TileData
       {
-        static constexpr size_t bufsize{TILE_SIZE * TILE_SIZE *
-                                        sizeOfType<FBType>()};
-        byte_t finaltile[bufsize];
+        const byte_t *finaltile;
+        // Tile size of the farm, the row pitch of finaltile
+        int size;
+        // Depth of the pixels when the farm sends it, same pitch
+        const float *depth{nullptr};
+
+        TilePixels(const vec2i &coords, const byte_t *buffer, int size)
+            : TileData(FBType, coords), finaltile(buffer), size(size)
+        {
+        }
+      };
+
+      /*! Part of a tile that lands on one screen, extent.x * extent.y
+          pixels follow row by row, then as many floats of depth if the
+          region has it */
+      struct TileRegion : public TileData
+      {
+        vec2i lower;
+        vec2i extent;
+        int32 hasDepth{0};
+
+        TileRegion(const OSPFrameBufferFormat &type,
+                   const vec2i &coords,
+                   const box2i &region,
+                   const int32 frame,
+                   const int32 scale = 1,
+                   const bool depth  = false)
+            : TileData(type, coords, frame, scale),
+              lower(region.lower),
+              extent(region.size()),
+              hasDepth(depth){};
+
+        byte_t *pixels()
+        {
+          return (byte_t *)(this + 1);
+        }
+
+        float *depth()
+        {
+          return (float *)(pixels() + extent.x * extent.y * sizeOfType(type));
+        }
 
-        TilePixels() : TileData(FBType){};
-        TilePixels(const vec2i &coords, const byte_t *buffer)
-            : TileData(FBType, coords)
+        /*! no pixels, the head says whether every display rank shows
+            frame or skips it */
+        bool isFramePresent() const
         {
-          std::memcpy(finaltile, buffer, bufsize);
+          return coords.x < 0;
+        }
+
+        bool showFrame() const
+        {
+          return coords.y > 0;
+        }
+
+        /*! header and pixels, the next region in a batch follows */
+        size_t byteSize() const
+        {
+          return sizeof(TileRegion) +
+                 extent.x * extent.y *
+                     (sizeOfType(type) + (hasDepth ? sizeof(float) : 0));
         }
       };
 
+      template <OSPFrameBufferFormat FBType>
+      inline size_t tileRegionSize(const box2i &region,
+                                   const bool depth = false)
+      {
+        return sizeof(TileRegion) +
+               region.size().x * region.size().y *
+                   (sizeOfType<FBType>() + (depth ? sizeof(float) : 0));
+      }
+
+      /*! rows of a tile with a pitch of TS pixels, 0 for a pitch only
+          known at run time */
+      template <OSPFrameBufferFormat FBType, int TS>
+      inline void copyTileRows(const byte_t *tile,
+                               int tileSize,
+                               const vec2i &origin,
+                               const vec2i &extent,
+                               byte_t *out)
+      {
+        constexpr size_t pixelSize = sizeOfType<FBType>();
+        const size_t pitch   = (TS ? TS : tileSize) * pixelSize;
+        const size_t rowSize = extent.x * pixelSize;
+        tile += origin.y * pitch + origin.x * pixelSize;
+        for (int y = 0; y < extent.y; y++)
+          std::memcpy(out + y * rowSize, tile + y * pitch, rowSize);
+      }
+
+      /*! crop region of tile into out, tileRegionSize bytes */
+      template <OSPFrameBufferFormat FBType>
+      inline void writeTileRegion(const TilePixels<FBType> &tile,
+                                  const box2i &region,
+                                  const int32 frame,
+                                  const int32 scale,
+                                  byte_t *out)
+      {
+        auto *header = new (out) TileRegion(
+            FBType, tile.coords, region, frame, scale, tile.depth);
+        const vec2i origin = region.lower - tile.coords;
+        const vec2i extent = region.size();
+        auto *pixels       = header->pixels();
+        switch (tile.size) {
+        case 32:
+          copyTileRows<FBType, 32>(tile.finaltile, 32, origin, extent, pixels);
+          break;
+        case 64:
+          copyTileRows<FBType, 64>(tile.finaltile, 64, origin, extent, pixels);
+          break;
+        case 128:
+          copyTileRows<FBType, 128>(
+              tile.finaltile, 128, origin, extent, pixels);
+          break;
+        case 256:
+          copyTileRows<FBType, 256>(
+              tile.finaltile, 256, origin, extent, pixels);
+          break;
+        default:
+          copyTileRows<FBType, 0>(
+              tile.finaltile, tile.size, origin, extent, pixels);
+        }
+        if (tile.depth) {
+          const size_t rowSize = extent.x * sizeof(float);
+          const float *depth   = tile.depth + origin.y * tile.size + origin.x;
+          byte_t *depthOut     = (byte_t *)header->depth();
+          for (int y = 0; y < extent.y; y++)
+            std::memcpy(depthOut + y * rowSize, depth + y * tile.size, rowSize);
+        }
+      }
+
+      /*! pixels of region into color, which holds the pixels from origin
+          on, width per row */
+      template <OSPFrameBufferFormat FBType>
+      inline void blitRegion(TileRegion *region,
+                             byte_t *color,
+                             const vec2i &origin,
+                             const int width)
+      {
+        constexpr size_t pixelSize = sizeOfType<FBType>();
+        const size_t rowSize       = region->extent.x * pixelSize;
+        const vec2i target         = region->lower - origin;
+        for (int y = 0; y < region->extent.y; y++) {
+          std::memcpy(color + ((target.y + y) * width + target.x) * pixelSize,
+                      region->pixels() + y * rowSize,
+                      rowSize);
+        }
+      }
+
+      /*! no pixels, the display rank keeps what it shows for the tile */
+      inline void writeTileUnchanged(const vec2i &coords,
+                                     const int32 frame,
+                                     const int32 scale,
+                                     byte_t *out)
+      {
+        new (out) TileRegion(
+            OSP_FB_NONE, coords, box2i(vec2i(0), vec2i(0)), frame, scale);
+      }
+
+      /*! one per frame to every display rank, behind the regions of the
+          frame that made it in time */
+      inline void writeFramePresent(const int32 frame,
+                                    const bool show,
+                                    byte_t *out)
+      {
+        new (out) TileRegion(OSP_FB_NONE,
+                             vec2i(-1, show),
+                             box2i(vec2i(0), vec2i(0)),
+                             frame);
+      }
+
+      /*! bytes written and time spent by a kernel, only recorded with
+          DW_MEASURE_TIMES. bytes per nanosecond is GB/s */
+      struct KernelStats
+      {
+        std::atomic<uint64> bytes{0};
+        std::atomic<uint64> nanoseconds{0};
+
+        double gbs() const
+        {
+          return nanoseconds ? double(bytes) / nanoseconds : 0.0;
+        }
+
+        void reset()
+        {
+          bytes = nanoseconds = 0;
+        }
+      };
+
+      struct KernelTimer
+      {
+        KernelTimer(KernelStats &stats, size_t bytes)
+#ifdef DW_MEASURE_TIMES
+            : stats(stats),
+              bytes(bytes),
+              start(std::chrono::high_resolution_clock::now())
+#endif
+        {
+        }
+
+        ~KernelTimer()
+        {
+#ifdef DW_MEASURE_TIMES
+          stats.bytes += bytes;
+          stats.nanoseconds +=
+              std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::high_resolution_clock::now() - start)
+                  .count();
+#endif
+        }
+
+#ifdef DW_MEASURE_TIMES
+        KernelStats &stats;
+        size_t bytes;
+        std::chrono::high_resolution_clock::time_point start;
+#endif
+      };
+
       struct DisplayFramebuffer : mpi::messaging::MessageHandler,
                                   ospray::FrameBuffer
       {
@@ -111,12 +349,17 @@ namespace ospray {
                            bool hasVarianceBuffer,
                            const vec2i &pos,
                            const vec2f &ratio,
-                           const vec2i &completeScreen);
+                           const vec2i &completeScreen,
+                           const int tileSize);
         ~DisplayFramebuffer() override;
         void incoming(const std::shared_ptr<maml::Message> &message) override;
         bool isFrameReady();
         bool setNumTilesDone(const vec2i &tilesDone);
-        void waitUntilFrameDone();
+        bool setNumTilesDone(const vec2i &tilesDone, const int32 frame);
+        /*! display ranks, wait for the present record of the head. False
+            when it came at the DW_PRESENT_DEADLINE_MS deadline before every
+            tile, the missing tiles then keep the previous frame content */
+        bool waitUntilFrameDone();
         const void *mapDepthBuffer() override;
         const void *mapColorBuffer() override;
         void unmap(const void *mappedMem) override;
@@ -127,6 +370,30 @@ namespace ospray {
         void beginFrame() override;
         float endFrame(const float errorThreshold) override;
         int getTotalTiles() const;
+        /*! head node, frames follow the tiles coming from the farm */
+        void openFrame(const int32 frame);
+        /*! head node, tell every display rank to show or skip frame and
+            send what is batched. Only the first call of a frame sends the
+            record */
+        void presentFrame(const int32 frame, const bool show);
+        /*! head node, past DW_PRESENT_DEADLINE_MS the display ranks show
+            the current frame with the tiles they have */
+        void presentAtDeadline();
+        /*! frame started by the last beginFrame */
+        int32 frame() const
+        {
+          return currentFrame;
+        }
+        /*! frame will be rendered at 1/scale, set before it begins */
+        void setFrameScale(const int32 frame, const int scale);
+        /*! scale of the frame started by the last beginFrame */
+        int scale() const
+        {
+          return grid->scale;
+        }
+        /*! camera frame is rendered with, set before it begins */
+        void setFrameCamera(const int32 frame, const FrameCamera &camera);
+        void setTileMask(const vec2i &numTiles, const std::vector<byte_t> &mask);
 
         template <OSPFrameBufferFormat FBType>
         inline void accum(TilePixels<FBType> *tile)
@@ -134,29 +401,306 @@ namespace ospray {
           throw std::runtime_error("Unknown type");
         }
 
+        /*! Tiles of the wall rendered at one scale, the frames rendered
+            at that scale wait for the required ones */
+        struct TileGrid
+        {
+          int scale{1};
+          vec2i maxTiles;
+          // Tiles this rank waits for, one bit per tile
+          std::vector<uint64_t> tilesRequired;
+          int numTilesRequired{0};
+          // Frame in which each tile last arrived, the first arrival of a
+          // tile in a frame counts it down
+          std::unique_ptr<std::atomic<int>[]> tilesFrame;
+          // Full scale, frame whose color buffer has the last pixels of
+          // each tile. Not the frame before when that one was dropped or
+          // missed the tile
+          std::unique_ptr<std::atomic<int>[]> pixelsFrame;
+          // Display ranks below full scale, the lower resolution pixels
+          // of the wall this screen upscales, kept from frame to frame
+          box2i footprint;
+          void *pixels{nullptr};
+
+          bool required(int t) const
+          {
+            return tilesRequired[t >> 6] & (uint64_t(1) << (t & 63));
+          }
+
+          /*! tile t arrived in frame, true when it is the first arrival
+              of the tile in frame. The frame of a tile only moves
+              forward, a late tile of an older frame does not hide the
+              tile of a newer one */
+          bool arrive(int t, const int32 frame)
+          {
+            if (!required(t))
+              return false;
+            return advance(tilesFrame[t], frame);
+          }
+
+          /*! the buffer of frame now has the pixels of tile t */
+          void setPixelsFrame(int t, const int32 frame)
+          {
+            advance(pixelsFrame[t], frame);
+          }
+
+          static bool advance(std::atomic<int> &seen, const int32 frame)
+          {
+            int current = seen;
+            while (current < frame) {
+              if (seen.compare_exchange_weak(current, frame))
+                return true;
+            }
+            return false;
+          }
+        };
+
+        /*! regions are already cropped to this screen by the head node,
+            regions of a lower scale go to its buffer until the frame is
+            upscaled */
+        template <OSPFrameBufferFormat FBType>
+        inline void accum(TileGrid &grid, TileRegion *region)
+        {
+          if (grid.scale == 1) {
+            blit<FBType>(region, (byte_t *)colorBuffer, pos, size.x);
+            if (region->hasDepth && depthBuffer)
+              blitDepth(region, depthBuffer);
+            grid.setPixelsFrame(tileIndex(grid, region->coords),
+                                region->frame);
+          } else
+            blit<FBType>(region,
+                         (byte_t *)grid.pixels,
+                         grid.footprint.lower,
+                         grid.footprint.size().x);
+          setNumTilesDone(grid, region->coords, region->frame);
+        }
+
+        template <OSPFrameBufferFormat FBType>
+        inline void blit(TileRegion *region, byte_t *color)
+        {
+          blit<FBType>(region, color, pos, size.x);
+        }
+
+        /*! color holds the pixels from origin on, width per row */
+        template <OSPFrameBufferFormat FBType>
+        inline void blit(TileRegion *region,
+                         byte_t *color,
+                         const vec2i &origin,
+                         const int width)
+        {
+          KernelTimer timer(blitStats,
+                            region->extent.x * region->extent.y *
+                                sizeOfType<FBType>());
+          blitRegion<FBType>(region, color, origin, width);
+        }
+
+        inline void blitDepth(TileRegion *region, float *depth)
+        {
+          const size_t rowSize = region->extent.x * sizeof(float);
+          const vec2i target   = region->lower - pos;
+          for (int y = 0; y < region->extent.y; y++) {
+            std::memcpy(depth + (target.y + y) * size.x + target.x,
+                        region->depth() + y * region->extent.x,
+                        rowSize);
+          }
+        }
+
         void createTiles();
 
+        /*! head node preview, box filters a full tile into the smaller
+            color buffer */
+        void downsampleTile(const vec2i &coords, const byte_t *pixels);
+
+        KernelStats blitStats;
+        KernelStats downsampleStats;
+        KernelStats convertStats;
+        KernelStats upscaleStats;
+        KernelStats reprojectStats;
+
         std::set<int> diff();
 
+        // Head node only, tiles forwarded to the display ranks
+        std::unique_ptr<TileBatcher> batcher;
+
+        /*! DW_USE_RMA, the head puts tile rows straight into the color
+            buffer the display ranks expose as an MPI window */
+        bool useRMA{false};
+
+        template <OSPFrameBufferFormat FBType>
+        inline void putTileRegion(int rank,
+                                  const TilePixels<FBType> &tile,
+                                  const box2i &region,
+                                  const vec2i &screenPos,
+                                  const vec2i &screenSize)
+        {
+          putRegion(rank,
+                    tile.finaltile,
+                    sizeOfType<FBType>(),
+                    tile.coords,
+                    region,
+                    screenPos,
+                    screenSize);
+        }
+
+        /*! head node, ms waited for the panels to show earlier frames
+            since the last call */
+        double takePresentWait()
+        {
+          return presentWaitMicroseconds.exchange(0) / 1000.0;
+        }
+
+        /*! head node, puts issued this frame are complete at the targets */
+        void flushRegions();
+        /*! display ranks, puts of this frame are visible locally */
+        void syncRegions();
+
+        /*! DW_FRAMES_IN_FLIGHT, frames the head may run ahead of the
+            panels. Display ranks keep as many color buffers and present
+            them from their own thread */
+        int framesInFlight{2};
+
+        /*! DW_PRESENT_DEADLINE_MS, 0 waits for every tile. Past the
+            deadline of the head every panel presents what it has */
+        int presentDeadline{0};
+
+        /*! display ranks of a frame buffer with depth and a buffer per
+            frame in flight. A frame whose camera moved starts as the last
+            full scale frame reprojected to it, shown right away, and its
+            tiles replace it as they arrive */
+        bool reproject{false};
+        // Tiles missing at the deadline and tiles arriving after it
+        std::atomic<size_t> tilesMissed{0};
+        std::atomic<size_t> tilesLate{0};
+        std::atomic<int64> lateMicroseconds{0};
+
+        // Tile size of the farm, from its hello
+        const int tileSize;
+
        protected:
-        std::atomic<size_t> numTilesDone{0};
-        std::mutex done;
-        std::condition_variable condition_done;
+        // Buffer of the current frame, one of colorBuffers
         void *colorBuffer = nullptr;
-        std::atomic<bool> frameActive{false};
-        std::atomic<bool> frameeDone{false};
+        std::vector<void *> colorBuffers;
+        // With reproject, depth of each color buffer, the full scale
+        // frame it holds and the camera of that frame
+        float *depthBuffer{nullptr};
+        std::vector<float *> depthBuffers;
+        std::vector<int32> bufferFrames;
+        std::vector<FrameCamera> bufferCameras;
+        FrameCamera frameCamera;
+        bool frameReprojected{false};
         vec2f ratio;
         vec2i pos;
         vec2i completeScreen;
 
-        std::set<int> tilesRequired;
-
-        std::mutex tilesDone_mutex;
-
-        std::set<int> tilesMissing;
+        // One grid per scale level, the current frame waits on grid
+        std::vector<TileGrid> grids;
+        TileGrid *grid{nullptr};
+        FrameCountdown countdown;
+        std::atomic<int> currentFrame{0};
+        // Head node, last frame whose present record went out. Display
+        // ranks, last frame whose record came, later regions of it are
+        // late. presentRecords holds the records of the frames not shown
+        // yet, under staging
+        std::atomic<int32> recordedFrame{0};
+        std::map<int32, bool> presentRecords;
+        std::condition_variable condition_recorded;
+        bool frameShown{true};
+        void presentRecord(const TileRegion *record);
+
+        /*! Regions of frames that have not started yet, keyed by frame and
+            replayed by beginFrame. currentFrame only moves under staging */
+        std::mutex staging;
+        std::map<int32, std::vector<byte_t>> stagedRegions;
+        // Scale and camera of the frames not started yet, under staging too
+        std::map<int32, int> frameScales;
+        std::map<int32, FrameCamera> frameCameras;
+
+        bool stageRegion(const TileRegion *region);
+        void accumRegion(TileRegion *region);
+        /*! bytes is the size of the batch the regions came in */
+        void accumRegions(const std::vector<TileRegion *> &regions,
+                          size_t bytes);
+
+        // Deadline of each frame in flight, indexed like colorBuffers
+        std::vector<std::chrono::high_resolution_clock::time_point> deadlines;
+
+        void keepMissingTiles();
+        /*! copy tile t from the buffer with its last pixels, a single
+            buffer still has it in place */
+        void keepTile(const int t);
+        /*! region of a frame whose present record came already, while
+            its buffer is not reused. The next deadline copies it forward */
+        void patchLateRegion(TileRegion *region);
+        void tileLate(const int32 frame);
+
+        void buildGrid(TileGrid &grid, const int scale);
+        TileGrid &gridOf(const int scale)
+        {
+          return grids[scaleLevel(scale)];
+        }
+        bool setNumTilesDone(TileGrid &grid,
+                             const vec2i &tilesDone,
+                             const int32 frame);
+        /*! display ranks, bilinear upscale of the current frame from the
+            buffer of its grid into colorBuffer */
+        void upscaleFrame();
+        /*! display ranks, the frame before in the buffer of frame seen
+            through frameCamera, false when there is nothing to reproject */
+        bool reprojectFrame(const int32 frame);
+
+        int tileIndex(const TileGrid &grid, const vec2i &coords) const
+        {
+          return (coords.y / tileSize) * grid.maxTiles.x + coords.x / tileSize;
+        }
 
-        vec2i maxTiles;
+        bool tileRequired(const TileGrid &grid, int t) const
+        {
+          return grid.required(t);
+        }
 
+        void putRegion(int rank,
+                       const byte_t *tilePixels,
+                       size_t pixelSize,
+                       const vec2i &coords,
+                       const box2i &region,
+                       const vec2i &screenPos,
+                       const vec2i &screenSize);
+        MPI_Datatype rowsType(int rows, int rowSize, int stride);
+
+        /*! frame shown on every panel, one MPI_Ibarrier per frame on
+            frameComm, framesInFlight of them outstanding at most */
+        void frameInFlight(const int32 frame);
+        void presentLoop();
+
+        std::thread presenter;
+        // RGBA8 copy of the frame shown, taken under presenting
+        std::vector<uint32> presentPixels;
+        /*! RGBA8 copy of colorBuffer into pixels, the caller holds
+            presenting or owns the buffer */
+        void copyForPresent(const void *color, std::vector<uint32> &pixels);
+        // RGBA8 copy of the reprojected preview, taken before the tiles of
+        // its frame blit over it. Pending until the presenter swaps it out
+        std::vector<uint32> previewPixels;
+        bool previewPending{false};
+        // Frame, whether to show it and whether it is a reprojected
+        // preview that does not finish it. Frame -1 stops the presenter
+        struct FramePresent
+        {
+          int32 frame;
+          bool show;
+          bool preview;
+        };
+        WorkQueue<FramePresent> framesDone;
+        std::mutex presenting;
+        std::condition_variable condition_presented;
+        int32 presentedFrame{0};
+
+        MPI_Comm frameComm{MPI_COMM_NULL};
+        std::vector<MPI_Request> frameRequests;
+        std::atomic<int64> presentWaitMicroseconds{0};
+
+        MPI_Win window{MPI_WIN_NULL};
+        std::map<std::tuple<int, int, int>, MPI_Datatype> rowsTypes;
       };
 
       template <>
@@ -174,37 +718,7 @@ namespace ospray {
       {
         if (!colorBufferFormat & OSP_FB_RGBA8)
           throw std::runtime_error("Incompatible buffer formats");
-        uint32 *color = (uint32 *) colorBuffer;
-        uint32 *pixels = (uint32 *) tile->finaltile;
-
-        if(mpicommon::IamAWorker()) {
-          tasking::parallel_for(TILE_SIZE, [&](const int iy) {
-            int y = ((tile->coords.y + iy) - pos.y);
-            if (y < 0 || y >= size.y)
-              return;
-            for (int ix = 0; ix < TILE_SIZE; ix++) {
-              int x = ((tile->coords.x + ix) - pos.x);
-              if (x < 0 || x >= size.x)
-                continue;
-              color[y * size.x + x] = pixels[iy * TILE_SIZE + ix];
-            }
-          });
-
-        } else {
-          int tsize_y =  int(1 / ratio.y);
-          int tsize_x =  int(1 / ratio.x);
-          for(int iy = 0; iy < TILE_SIZE; iy += tsize_y) {
-            int y = ((tile->coords.y + iy) - pos.y) * ratio.y;
-            if (y < 0 || y >= size.y)
-              continue;
-            for (int ix = 0; ix < TILE_SIZE; ix += tsize_x) {
-              int x = ((tile->coords.x + ix) - pos.x) * ratio.x;
-              if (x < 0 || x >= size.x)
-                continue;
-              color[y * size.x + x] = pixels[iy * TILE_SIZE + ix];
-            }
-          }
-        }
+        downsampleTile(tile->coords, tile->finaltile);
         setNumTilesDone(tile->coords);
       }
 
@@ -214,36 +728,7 @@ namespace ospray {
       {
         if (!colorBufferFormat & OSP_FB_RGBA32F)
           throw std::runtime_error("Incompatible buffer formats");
-        vec4f *color  = (vec4f *)colorBuffer;
-        vec4f *pixels = (vec4f *)tile->finaltile;
-        if(mpicommon::IamAWorker()) {
-          tasking::parallel_for(TILE_SIZE, [&](const int iy) {
-            int y = ((tile->coords.y + iy) - pos.y);
-            if (y < 0 || y >= size.y)
-              return;
-            for (int ix = 0; ix < TILE_SIZE; ix++) {
-              int x = ((tile->coords.x + ix) - pos.x);
-              if (x < 0 || x >= size.x)
-                continue;
-              color[y * size.x + x] = pixels[iy * TILE_SIZE + ix];
-            }
-          });
-
-        } else {
-          int tsize_y =  int(1 / ratio.y);
-          int tsize_x =  int(1 / ratio.x);
-          for(int iy = 0; iy < TILE_SIZE; iy += tsize_y) {
-            int y = ((tile->coords.y + iy) - pos.y) * ratio.y;
-            if (y < 0 || y >= size.y)
-              continue;
-            for (int ix = 0; ix < TILE_SIZE; ix += tsize_x) {
-              int x = ((tile->coords.x + ix) - pos.x) * ratio.x;
-              if (x < 0 || x >= size.x)
-                continue;
-              color[y * size.x + x] = pixels[iy * TILE_SIZE + ix];
-            }
-          }
-        }
+        downsampleTile(tile->coords, tile->finaltile);
         setNumTilesDone(tile->coords);
       }
 
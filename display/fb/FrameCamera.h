@@ -0,0 +1,78 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#pragma once
+
+#include "ospcommon/vec.h"
+
+#include <cmath>
+
+namespace ospray {
+  namespace dw {
+    namespace display {
+
+      /*! perspective camera a frame is rendered with, from the parameters
+          the application set on it. Display ranks show the last frame
+          through the camera of the next one until its tiles arrive */
+      struct FrameCamera
+      {
+        // OSPRay perspective camera defaults
+        vec3f pos{0.f, 0.f, 0.f};
+        vec3f dir{0.f, 0.f, 1.f};
+        vec3f up{0.f, 1.f, 0.f};
+        float fovy{60.f};
+        float aspect{1.f};
+        bool valid{false};
+
+        /*! origin, normalized view direction and image plane axes scaled
+            to the plane at distance 1, the way the camera sets up its
+            rays. Twelve floats for the reprojection kernels */
+        void basis(float out[12]) const
+        {
+          const vec3f d  = normalize(dir);
+          const float h  = 2.f * std::tan(0.5f * fovy * float(M_PI) / 180.f);
+          const vec3f du = normalize(cross(d, up)) * (h * aspect);
+          const vec3f dv = normalize(cross(du, d)) * h;
+          const vec3f axes[4] = {pos, d, du, dv};
+          for (int a = 0; a < 4; a++) {
+            out[3 * a + 0] = axes[a].x;
+            out[3 * a + 1] = axes[a].y;
+            out[3 * a + 2] = axes[a].z;
+          }
+        }
+
+        bool operator==(const FrameCamera &other) const
+        {
+          return valid == other.valid && pos == other.pos &&
+                 dir == other.dir && up == other.up && fovy == other.fovy &&
+                 aspect == other.aspect;
+        }
+      };
+
+    }  // namespace display
+  }    // namespace dw
+}  // namespace ospray
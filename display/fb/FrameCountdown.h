@@ -0,0 +1,129 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace ospray {
+  namespace dw {
+    namespace display {
+
+      /*! tiles the current frame still waits for. The frame and its
+          count share one atomic, so a tile of a frame that already gave
+          way to the next one counts nothing. The tile that brings the
+          count to zero sets done under the mutex of the waiter, so the
+          wakeup can not be lost */
+      struct FrameCountdown
+      {
+        /*! frame waiting for tiles starts */
+        void reset(const int32_t frame, const int tiles)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          state = pack(frame, tiles);
+          done  = (tiles == 0);
+        }
+
+        /*! one more tile of frame arrived, true when it was the last one */
+        bool arrive(const int32_t frame)
+        {
+          uint64_t current = state;
+          while (frameOf(current) == frame && countOf(current) > 0) {
+            if (state.compare_exchange_weak(current, current - 1)) {
+              if (countOf(current) != 1)
+                return false;
+              finish(frame);
+              return true;
+            }
+          }
+          return false;
+        }
+
+        /*! frame is over, with or without the tiles still pending */
+        void finish(const int32_t frame)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (frameOf(state) != frame)
+            return;
+          done = true;
+          condition.notify_all();
+        }
+
+        bool isDone() const
+        {
+          return done;
+        }
+
+        int remaining() const
+        {
+          return countOf(state);
+        }
+
+        void wait()
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          condition.wait(lock, [&] { return isDone(); });
+        }
+
+        /*! false when the deadline passed first */
+        template <typename TimePoint>
+        bool waitUntil(const TimePoint &deadline)
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          return condition.wait_until(
+              lock, deadline, [&] { return isDone(); });
+        }
+
+       private:
+        static uint64_t pack(const int32_t frame, const int tiles)
+        {
+          return (uint64_t(uint32_t(frame)) << 32) | uint32_t(tiles);
+        }
+
+        static int32_t frameOf(const uint64_t state)
+        {
+          return int32_t(state >> 32);
+        }
+
+        static int countOf(const uint64_t state)
+        {
+          return int(uint32_t(state));
+        }
+
+        // Frame in the upper half, tiles it still waits for in the lower
+        std::atomic<uint64_t> state{0};
+        std::atomic<bool> done{false};
+        std::mutex mutex;
+        std::condition_variable condition;
+      };
+
+    }  // namespace display
+  }    // namespace dw
+}  // namespace ospray
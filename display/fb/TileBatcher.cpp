@@ -0,0 +1,137 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#include "DisplayFramebuffer.h"
+#include "TileBatcher.h"
+#include "common/networking/BufferPool.h"
+#include "ospcommon/utility/getEnvVar.h"
+
+#include <algorithm>
+#include <chrono>
+
+ospray::dw::display::TileBatcher::TileBatcher(const ObjectHandle &handle,
+                                              const int tileSize,
+                                              const bool depth)
+    : stallTime(mpicommon::world.size - 1, 0),
+      handle(handle),
+      regionSize(tileRegionSize<OSP_FB_RGBA32F>(
+          box2i(vec2i(0), vec2i(tileSize)), depth)),
+      messages(mpicommon::world.size - 1),
+      used(mpicommon::world.size - 1, 0),
+      inFlight(mpicommon::world.size - 1, 0)
+{
+  batchSize = utility::getEnvVar<int>("DW_BATCH_SIZE").value_or(256 * 1024);
+  creditBytes =
+      utility::getEnvVar<int>("DW_CREDIT_BYTES").value_or(4 * 1024 * 1024);
+}
+
+ospray::byte_t *ospray::dw::display::TileBatcher::reserve(int rank,
+                                                          size_t bytes)
+{
+  auto &message = messages[rank];
+  if (message && used[rank] + bytes > message->size)
+    send(rank);
+  if (!message) {
+    // Sent as soon as it reaches batchSize, so one more region always fits
+    message = std::make_shared<maml::Message>(
+        std::max(batchSize + regionSize, bytes));
+  }
+  return message->data + used[rank];
+}
+
+void ospray::dw::display::TileBatcher::commit(int rank, size_t bytes)
+{
+  used[rank] += bytes;
+  numRegions++;
+  mpicommon::copyStats().count(bytes);
+  if (used[rank] >= batchSize)
+    send(rank);
+}
+
+void ospray::dw::display::TileBatcher::presentFrame(const int32 frame,
+                                                    const bool show)
+{
+  for (int rank = 0; rank < messages.size(); rank++) {
+    writeFramePresent(frame, show, reserve(rank, sizeof(TileRegion)));
+    commit(rank, sizeof(TileRegion));
+  }
+}
+
+void ospray::dw::display::TileBatcher::flush()
+{
+  for (int rank = 0; rank < messages.size(); rank++) {
+    if (used[rank])
+      send(rank);
+  }
+}
+
+void ospray::dw::display::TileBatcher::flush(int rank)
+{
+  if (used[rank])
+    send(rank);
+}
+
+void ospray::dw::display::TileBatcher::returnCredits(int rank, size_t bytes)
+{
+  {
+    std::lock_guard<std::mutex> lock(credits);
+    inFlight[rank] -= std::min(bytes, inFlight[rank]);
+  }
+  condition_credits.notify_all();
+}
+
+int ospray::dw::display::TileBatcher::slowestRank() const
+{
+  return std::max_element(stallTime.begin(), stallTime.end()) -
+         stallTime.begin();
+}
+
+void ospray::dw::display::TileBatcher::send(int rank)
+{
+  const size_t bytes = used[rank];
+  {
+    // A batch larger than the window still goes once nothing is in flight
+    std::unique_lock<std::mutex> lock(credits);
+    auto start = std::chrono::high_resolution_clock::now();
+    condition_credits.wait(lock, [&] {
+      return inFlight[rank] == 0 || inFlight[rank] + bytes <= creditBytes;
+    });
+    inFlight[rank] += bytes;
+    stallTime[rank] += std::chrono::duration<double>(
+                           std::chrono::high_resolution_clock::now() - start)
+                           .count();
+  }
+
+  // Only the written part goes on the wire
+  auto message  = std::move(messages[rank]);
+  message->size = bytes;
+  mpi::messaging::sendTo(
+      mpicommon::globalRankFromWorkerRank(rank), handle, message);
+  numMessages++;
+  numBytes += bytes;
+  used[rank] = 0;
+}
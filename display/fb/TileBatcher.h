@@ -0,0 +1,100 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#pragma once
+
+#include <mpi/common/Messaging.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ospray {
+  namespace dw {
+    namespace display {
+
+      /*! sent back by a display rank once it processed a batch */
+      struct CreditMessage
+      {
+        int32 rank;
+        uint64 bytes;
+      };
+
+      /*! Head node side, packs the tile regions going to the same display
+          rank into one message. Regions are written straight into the
+          message that is sent, which goes once it is larger than
+          DW_BATCH_SIZE bytes, and every message is sent at the end of the
+          frame. At most DW_CREDIT_BYTES bytes are in flight to a display
+          rank, sending waits until the rank returns credits */
+      struct TileBatcher
+      {
+        /*! regions carry depth when the frame buffer has it */
+        TileBatcher(const ObjectHandle &handle,
+                    const int tileSize,
+                    const bool depth);
+
+        /*! room for bytes more in the batch of rank, call commit once
+            they are written */
+        byte_t *reserve(int rank, size_t bytes);
+        void commit(int rank, size_t bytes);
+        /*! tell every display rank to show frame or to skip it */
+        void presentFrame(const int32 frame, const bool show);
+        void flush();
+        /*! send the batch of rank now, it is not waiting for more */
+        void flush(int rank);
+        /*! display rank processed bytes, called from the messaging thread */
+        void returnCredits(int rank, size_t bytes);
+        /*! display rank the head waited on the longest */
+        int slowestRank() const;
+
+        size_t numMessages{0};
+        size_t numRegions{0};
+        size_t numBytes{0};
+        // Seconds spent waiting for credits, per display rank
+        std::vector<double> stallTime;
+
+       protected:
+        void send(int rank);
+
+        ObjectHandle handle;
+        size_t batchSize;
+        // Bytes of the largest region, a batch always has room for one
+        size_t regionSize;
+        // Batch message being filled and bytes written, per display rank
+        std::vector<std::shared_ptr<maml::Message>> messages;
+        std::vector<size_t> used;
+
+        size_t creditBytes;
+        std::vector<size_t> inFlight;
+        std::mutex credits;
+        std::condition_variable condition_credits;
+      };
+
+    }  // namespace display
+  }    // namespace dw
+}  // namespace ospray
@@ -25,11 +25,14 @@
    =======================================================================================
    @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
  */
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <numeric>
 
 #include <display/glDisplay/glDisplay.h>
 #include "WallConfig.h"
+#include "ospcommon/tasking/parallel_for.h"
 #include "ospcommon/utility/getEnvVar.h"
 
 namespace ospray {
@@ -67,54 +70,56 @@ namespace ospray {
             sync();
         }
 
+        wallconfig::wallconfig(const WallLayout &layout) {
+            setLayout(layout);
+            buildRoutes();
+        }
+
+        void wallconfig::setLayout(const WallLayout &layout) {
+            displayConfig = layout.displayConfig;
+            basel_compensation = layout.basel_compensation;
+            localScreen = layout.localScreen;
+            orientation = layout.orientation;
+
+            completeScreeen.x = localScreen.x * displayConfig.x +
+                                basel_compensation.x * (displayConfig.x - 1);
+            completeScreeen.y = localScreen.y * displayConfig.y +
+                                basel_compensation.y * (displayConfig.y - 1);
+
+            maxTiles = ospcommon::divRoundUp(completeScreeen, ospcommon::vec2i(tileSize));
+        }
+
         void wallconfig::sync() {
+            WallLayout layout;
+
             if (mpicommon::IamTheMaster()) {
                 auto envfilename = utility::getEnvVar<std::string>("DW_CONFIG_FILE");
                 auto filename = envfilename.value_or("default.conf");
 
                 std::ifstream conffile(filename, std::ios::in);
                 if (conffile.is_open()) {
-                    conffile >> localScreen.x >> localScreen.y;
-                    conffile >> displayConfig.x >> displayConfig.y;
-                    conffile >> basel_compensation.x >> basel_compensation.y;
-                    conffile >> orientation;
+                    conffile >> layout.localScreen.x >> layout.localScreen.y;
+                    conffile >> layout.displayConfig.x >> layout.displayConfig.y;
+                    conffile >> layout.basel_compensation.x >> layout.basel_compensation.y;
+                    conffile >> layout.orientation;
 
                     // Send data to all workers
                     MPI_CALL(Bcast(
-                            this, sizeof(wallconfig), MPI_BYTE, 0, mpicommon::world.comm));
-
-                    completeScreeen.x = localScreen.x * displayConfig.x +
-                                        basel_compensation.x * (displayConfig.x - 1);
-                    completeScreeen.y = localScreen.y * displayConfig.y +
-                                        basel_compensation.y * (displayConfig.y - 1);
-
-                    maxTiles = ospcommon::divRoundUp(completeScreeen, ospcommon::vec2i(TILE_SIZE));
-
-                    std::vector<vec2i> screensPos;
-
-                    int ID =0;
-                    if (orientation == 0)
-                        for (int y = 0; y < completeScreeen.y; y += localScreen.y + basel_compensation.y)
-                            for (int x = 0; x < completeScreeen.x; x += localScreen.x + basel_compensation.x) {
-                                screensPos.push_back(vec2i(x, y));
-                            }
-                    else
-                        for (int x = 0; x < completeScreeen.x; x += localScreen.x + basel_compensation.x) {
-                            for (int y = 0; y < completeScreeen.y; y += localScreen.x + basel_compensation.y)
-                                screensPos.push_back(vec2i(x, y));
-                            }
-
+                            &layout, sizeof(layout), MPI_BYTE, 0, mpicommon::world.comm));
 
+                    setLayout(layout);
 
-                    for (int y = 0; y < completeScreeen.y; y += TILE_SIZE)
-                        for (int x = 0; x < completeScreeen.x; x += TILE_SIZE) {
-                                whichRanks(screensPos,vec2i(x,y));
-                        }
+                    auto start = std::chrono::high_resolution_clock::now();
+                    buildRoutes();
+                    auto end = std::chrono::high_resolution_clock::now();
 
                     std::cout << "Display configuration:" << std::endl;
                     std::cout << "   Total display size:" << completeScreeen << std::endl;
                     std::cout << "           Basel size:" << basel_compensation << std::endl;
                     std::cout << "     Each screen size:" << localScreen << std::endl;
+                    std::cout << "        Routing table:" << routeTables[0].routes.size() << " routes in "
+                              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+                              << "us" << std::endl;
 
                 } else {
                     throw "Unable to open file : " + filename;
@@ -122,27 +127,21 @@ namespace ospray {
             } else {
                 // Send data to all workers
                 MPI_CALL(Bcast(
-                        this, sizeof(wallconfig), MPI_BYTE, 0, mpicommon::world.comm));
+                        &layout, sizeof(layout), MPI_BYTE, 0, mpicommon::world.comm));
 
+                setLayout(layout);
 
                 dw::glDisplay::setScreen(localScreen);
 
 
                 int x = (orientation == 0) ? (mpicommon::worker.rank % displayConfig.x)
-                                           : (mpicommon::worker.rank / displayConfig.x);
+                                           : (mpicommon::worker.rank / displayConfig.y);
                 int y = (orientation == 0) ? (mpicommon::worker.rank / displayConfig.x)
                                            : (mpicommon::worker.rank % displayConfig.y);
 
                 screenID = vec2i(x, y);
 
-                localPosition.x = localScreen.x * x + basel_compensation.x * x;
-                localPosition.y = localScreen.y * y + basel_compensation.y * y;
-
-                completeScreeen.x = localScreen.x * displayConfig.x +
-                                    basel_compensation.x * (displayConfig.x - 1);
-                completeScreeen.y = localScreen.y * displayConfig.y +
-                                    basel_compensation.y * (displayConfig.y - 1);
-
+                localPosition = screenPosition(mpicommon::worker.rank);
             }
         }
 
@@ -151,19 +150,94 @@ namespace ospray {
                                       : (y + x * displayConfig.y);
         }
 
-        void wallconfig::whichRanks(std::vector<vec2i> &screensPos,const vec2i &pos) {
-            auto ID = tileID(maxTiles,pos);
-            TileRankMap[ID] = std::set<int>();
-            for(int i = 0; i < screensPos.size(); i++) {
-                if(tileBelongsTo(pos,vec2i(TILE_SIZE), screensPos[i], localScreen)) {
-                    TileRankMap[ID].insert(i);
+        int wallconfig::tileRoutes(const vec2i &pos, const int &scale, TileRoute *out) {
+            // Only the screens under the tile footprint can overlap it, a
+            // screen reaches one pixel past its edges at a lower scale
+            const vec2i pitch = localScreen + basel_compensation;
+            const vec2i reach = vec2i(scale > 1 ? scale : 0);
+            const vec2i first = max(pos * scale - reach, vec2i(0)) / pitch;
+            const vec2i last = min((pos + vec2i(tileSize)) * scale + reach - vec2i(1),
+                                   completeScreeen - vec2i(1)) / pitch;
+            int count = 0;
+            for (int y = first.y; y <= min(last.y, displayConfig.y - 1); y++)
+                for (int x = first.x; x <= min(last.x, displayConfig.x - 1); x++) {
+                    const vec2i screen = vec2i(x, y) * pitch;
+                    const box2i visible = scale > 1
+                            ? scaledFootprint(screen, localScreen, completeScreeen, scale)
+                            : box2i(screen, screen + localScreen);
+                    const box2i region(max(pos, visible.lower),
+                                       min(pos + vec2i(tileSize), visible.upper));
+                    if (region.lower.x >= region.upper.x || region.lower.y >= region.upper.y)
+                        continue;
+                    if (out)
+                        out[count] = TileRoute{displayRank(x, y), region};
+                    count++;
                 }
+            return count;
+        }
+
+        void wallconfig::buildRoutes() {
+            for (int level = 0; level < numScaleLevels; level++) {
+                const int scale = 1 << level;
+                auto &table = routeTables[level];
+                table.numTiles = divRoundUp(divRoundUp(completeScreeen, vec2i(scale)),
+                                            vec2i(tileSize));
+                const int numTiles = table.numTiles.x * table.numTiles.y;
+                auto tilePos = [&](const int &t) {
+                    return vec2i(t % table.numTiles.x, t / table.numTiles.x) * tileSize;
+                };
+
+                auto &routeOffset = table.routeOffset;
+                routeOffset.assign(numTiles + 1, 0);
+                tasking::parallel_for(numTiles, [&](const int t) {
+                    routeOffset[t + 1] = tileRoutes(tilePos(t), scale, nullptr);
+                });
+                std::partial_sum(routeOffset.begin(), routeOffset.end(), routeOffset.begin());
+
+                table.routes.resize(routeOffset[numTiles]);
+                tasking::parallel_for(numTiles, [&](const int t) {
+                    tileRoutes(tilePos(t), scale, table.routes.data() + routeOffset[t]);
+                });
             }
         }
 
-        std::set<int> &wallconfig::getRanks(const vec2i &pos) {
-            int ID = tileID(maxTiles, pos);
-            return TileRankMap[ID];
+        TileRoutes wallconfig::getRoutes(const vec2i &pos, const int &scale) const {
+            const auto &table = routeTables[scaleLevel(scale)];
+            const int t = tileID(table.numTiles, pos / tileSize);
+            return TileRoutes{table.routes.data() + table.routeOffset[t],
+                              table.routes.data() + table.routeOffset[t + 1]};
+        }
+
+        vec2i wallconfig::screenPosition(const int &rank) {
+            int x = (orientation == 0) ? (rank % displayConfig.x)
+                                       : (rank / displayConfig.y);
+            int y = (orientation == 0) ? (rank / displayConfig.x)
+                                       : (rank % displayConfig.y);
+            return vec2i(x, y) * (localScreen + basel_compensation);
+        }
+
+        box2i wallconfig::cropTile(const int &rank, const vec2i &pos) {
+            const vec2i screen = screenPosition(rank);
+            return box2i(max(pos, screen),
+                         min(pos + vec2i(tileSize), screen + localScreen));
+        }
+
+        void wallconfig::setTileSize(const int &size) {
+            if (size == tileSize)
+                return;
+            tileSize = size;
+            maxTiles = ospcommon::divRoundUp(completeScreeen, ospcommon::vec2i(tileSize));
+            if (mpicommon::IamTheMaster())
+                buildRoutes();
+        }
+
+        std::vector<byte_t> wallconfig::tileMask() {
+            std::vector<byte_t> mask(maxTiles.x * maxTiles.y);
+            for (int y = 0; y < maxTiles.y; y++)
+                for (int x = 0; x < maxTiles.x; x++)
+                    mask[y * maxTiles.x + x] =
+                            !getRoutes(vec2i(x, y) * tileSize).empty();
+            return mask;
         }
 
     }  // namespace dw
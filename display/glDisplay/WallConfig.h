@@ -29,21 +29,82 @@
 #define OSPRAY_WALLCONFIG_H
 
 #include <common/Managed.h>
+#include <ospcommon/box.h>
 #include <ospcommon/vec.h>
 
-#include <map>
-#include <set>
+#include <vector>
 
 namespace ospray {
     namespace dw {
 
         using namespace ospcommon;
 
+        /* Display rank and the pixels of a tile that land on its screen */
+        struct TileRoute {
+            int rank;
+            box2i region;
+        };
+
+        struct TileRoutes {
+            const TileRoute *first;
+            const TileRoute *last;
+
+            const TileRoute *begin() const { return first; }
+            const TileRoute *end() const { return last; }
+            bool empty() const { return first == last; }
+            size_t size() const { return last - first; }
+        };
+
+        /* While interacting the wall may be rendered at 1/scale of its
+         * size, scale = 1 << level */
+        constexpr int numScaleLevels = 3;
+
+        inline int scaleLevel(const int &scale) {
+            int level = 0;
+            while ((1 << level) < scale && level < numScaleLevels - 1)
+                level++;
+            return level;
+        }
+
+        /* Pixels of the wall rendered at 1/scale that the screen at pos
+         * needs, one more on each side for the bilinear upscale */
+        inline box2i scaledFootprint(const vec2i &pos,
+                                     const vec2i &size,
+                                     const vec2i &wall,
+                                     const int &scale) {
+            const vec2i lowres = divRoundUp(wall, vec2i(scale));
+            return box2i(max(pos / scale - vec2i(1), vec2i(0)),
+                         min(divRoundUp(pos + size, vec2i(scale)) + vec2i(1),
+                             lowres));
+        }
+
+        /* Plain data of the configuration file, broadcast as bytes */
+        struct WallLayout {
+            vec2i displayConfig;
+            vec2i basel_compensation;
+            vec2i localScreen;
+            int orientation;
+        };
+
         struct wallconfig : public ManagedObject {
             ~wallconfig() = default;
             wallconfig();
+            /* Head node view of layout without reading or broadcasting
+             * it, for tools and benchmarks */
+            explicit wallconfig(const WallLayout &layout);
             void sync();
-            std::set<int> &getRanks(const vec2i &pos);
+            /* Display ranks that need the tile at pos (in pixels of the
+             * wall rendered at 1/scale) */
+            TileRoutes getRoutes(const vec2i &pos, const int &scale = 1) const;
+            /* One byte per tile, 0 when the tile is fully behind the bezels
+             */
+            std::vector<byte_t> tileMask();
+            /* Position of the screen driven by display rank in the wall */
+            vec2i screenPosition(const int &rank);
+            /* Pixels of the tile at pos that land on the screen of rank */
+            box2i cropTile(const int &rank, const vec2i &pos);
+            /* Tiles of the farm are tileSize^2 pixels, rebuilds the routes */
+            void setTileSize(const int &size);
 
             vec2i displayConfig;
             vec2i basel_compensation;
@@ -53,15 +114,23 @@ namespace ospray {
             vec2i localPosition;
             vec2i screenID;
             vec2i maxTiles;
+            int tileSize{TILE_SIZE};
 
         protected:
-            std::map<vec2i, std::set<int>> TileRankMap;
-//            std::vector<vec2i> screensPos;
-//            std::vector<int> screensIDs;
+            /* Flat tile to rank table of one scale, routes of tile t are
+             * routes[routeOffset[t]] .. routes[routeOffset[t + 1]] */
+            struct RouteTable {
+                vec2i numTiles;
+                std::vector<int> routeOffset;
+                std::vector<TileRoute> routes;
+            };
+            RouteTable routeTables[numScaleLevels];
 
             int displayRank(const int &x, const int &y);
         private:
-            void whichRanks(std::vector<vec2i> &screensPos, const vec2i &pos);
+            void setLayout(const WallLayout &layout);
+            void buildRoutes();
+            int tileRoutes(const vec2i &pos, const int &scale, TileRoute *out);
         };
     }  // namespace dw
 }  // namespace ospray
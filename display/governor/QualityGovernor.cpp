@@ -0,0 +1,228 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#include "QualityGovernor.h"
+#include "ospcommon/utility/getEnvVar.h"
+
+#include <algorithm>
+
+ospray::dw::display::QualityGovernor::QualityGovernor()
+{
+  // The farm starts with the codec of its build
+  settings.compress = mpicommon::defaultCodec() != mpicommon::CODEC_NONE;
+
+  auto DW_GOVERNOR_LOG = utility::getEnvVar<std::string>("DW_GOVERNOR_LOG");
+  if (DW_GOVERNOR_LOG) {
+    log.open(DW_GOVERNOR_LOG.value(), std::ios::out | std::ios::trunc);
+    if (!log.is_open())
+      throw std::runtime_error("Unable to open " + DW_GOVERNOR_LOG.value());
+    log << "kind,frame,dropped,scale,samples,compress,frame_ms,render_ms,"
+           "link_ms,forward_ms,present_ms,focus_ms,bytes,raw_bytes,slowest,"
+           "action"
+        << std::endl;
+  }
+}
+
+void ospray::dw::display::QualityGovernor::configure(float targetFrameTime,
+                                                     bool scaleKnob,
+                                                     bool samplesKnob,
+                                                     bool codecKnob)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  this->targetFrameTime = targetFrameTime;
+  this->scaleKnob       = scaleKnob;
+  this->samplesKnob     = samplesKnob;
+  this->codecKnob =
+      codecKnob && mpicommon::defaultCodec() != mpicommon::CODEC_NONE;
+  if (!scaleKnob)
+    settings.scaleLevel = 0;
+  if (!samplesKnob)
+    settings.samples = 0;
+}
+
+ospray::dw::display::QualitySettings
+ospray::dw::display::QualityGovernor::decide(bool interacting, int maxSamples)
+{
+  // A few frames with the same settings before moving again
+  static constexpr int measuredFrames = 3;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (measured >= measuredFrames) {
+    const QualitySettings before = settings;
+    const char *action           = adjust(maxSamples);
+    if (log.is_open()) {
+      log << "decision," << mean.frame << ",0," << before.scale() << ","
+          << before.samples << "," << before.compress << ","
+          << mean.frameTime << "," << mean.renderTime << ","
+          << mean.linkTime << "," << mean.forwardTime << ","
+          << mean.presentTime << "," << mean.focusTime << "," << mean.bytes
+          << "," << mean.rawBytes << "," << stageName(slowestStage(mean))
+          << "," << action << std::endl;
+    }
+    if (!(settings == before)) {
+      measured = 0;
+      mean     = FrameMeasurements();
+    }
+  }
+
+  // Without interaction the frame is shown for a while, full quality
+  QualitySettings next = settings;
+  if (!interacting) {
+    next.scaleLevel = 0;
+    next.samples    = 0;
+  }
+  return next;
+}
+
+const char *ospray::dw::display::QualityGovernor::adjust(int maxSamples)
+{
+  const double target = targetFrameTime;
+  const Stage slowest = slowestStage(mean);
+  const int samples =
+      settings.samples ? std::min(settings.samples, maxSamples) : maxSamples;
+
+  if (mean.frameTime > 1.2 * target) {
+    if (codecKnob && !settings.compress && slowest == STAGE_LINK) {
+      settings.compress = true;
+      return "compress";
+    }
+    if (samplesKnob && slowest == STAGE_RENDER && samples > 1) {
+      settings.samples = samples / 2;
+      return "fewer samples";
+    }
+    if (scaleKnob && settings.scaleLevel < numScaleLevels - 1 &&
+        (slowest == STAGE_RENDER || slowest == STAGE_LINK)) {
+      settings.scaleLevel++;
+      return "lower scale";
+    }
+    return "hold";
+  }
+
+  // The finer setting has to fit the target, a scale level has four
+  // times the pixels and twice the samples take twice as long
+  if (settings.scaleLevel > 0 && mean.frameTime * 4.0 < target) {
+    settings.scaleLevel--;
+    return "higher scale";
+  }
+  if (settings.samples && mean.frameTime * 2.0 < target) {
+    settings.samples *= 2;
+    if (settings.samples >= maxSamples)
+      settings.samples = 0;
+    return "more samples";
+  }
+  // Raw tiles save the head the decompression when the link has room
+  const double rawRatio = mean.bytes ? double(mean.rawBytes) / mean.bytes : 1.0;
+  if (codecKnob && settings.compress && slowest == STAGE_FORWARD &&
+      mean.linkTime * rawRatio < 0.5 * target) {
+    settings.compress = false;
+    return "no compression";
+  }
+  return "hold";
+}
+
+void ospray::dw::display::QualityGovernor::measure(
+    const FrameMeasurements &frame)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  FrameMeasurements measuredFrame = frame;
+
+  // Best throughput seen, forgotten slowly in case the link degrades
+  linkThroughput *= 0.99;
+  if (frame.linkTime > 0.0)
+    linkThroughput = std::max(linkThroughput, frame.bytes / frame.linkTime);
+  measuredFrame.linkTime =
+      linkThroughput > 0.0 ? frame.bytes / linkThroughput : 0.0;
+
+  // Dropped frames end early, frames of other settings say nothing about
+  // these ones
+  const bool counted = !frame.dropped && frame.settings == settings;
+  if (counted) {
+    const double n = measured;
+    auto average   = [&](double &running, double value) {
+      running = (running * n + value) / (n + 1.0);
+    };
+    average(mean.frameTime, measuredFrame.frameTime);
+    average(mean.renderTime, measuredFrame.renderTime);
+    average(mean.linkTime, measuredFrame.linkTime);
+    average(mean.forwardTime, measuredFrame.forwardTime);
+    average(mean.presentTime, measuredFrame.presentTime);
+    average(mean.focusTime, measuredFrame.focusTime);
+    mean.bytes    = (mean.bytes * measured + frame.bytes) / (measured + 1);
+    mean.rawBytes = (mean.rawBytes * measured + frame.rawBytes) / (measured + 1);
+    mean.frame    = frame.frame;
+    measured++;
+  }
+
+  if (log.is_open()) {
+    log << "frame," << frame.frame << "," << frame.dropped << ","
+        << frame.settings.scale() << "," << frame.settings.samples << ","
+        << frame.settings.compress << "," << measuredFrame.frameTime << ","
+        << measuredFrame.renderTime << "," << measuredFrame.linkTime << ","
+        << measuredFrame.forwardTime << "," << measuredFrame.presentTime
+        << "," << measuredFrame.focusTime << "," << frame.bytes << ","
+        << frame.rawBytes << "," << stageName(slowestStage(measuredFrame))
+        << "," << (counted ? "counted" : "ignored") << std::endl;
+  }
+}
+
+double ospray::dw::display::QualityGovernor::frameTime()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return mean.frameTime;
+}
+
+ospray::dw::display::QualityGovernor::Stage
+ospray::dw::display::QualityGovernor::slowestStage(
+    const FrameMeasurements &frame)
+{
+  Stage slowest  = STAGE_RENDER;
+  double longest = frame.renderTime;
+  if (frame.linkTime > longest) {
+    slowest = STAGE_LINK;
+    longest = frame.linkTime;
+  }
+  if (frame.forwardTime > longest) {
+    slowest = STAGE_FORWARD;
+    longest = frame.forwardTime;
+  }
+  if (frame.presentTime > longest)
+    slowest = STAGE_PRESENT;
+  return slowest;
+}
+
+const char *ospray::dw::display::QualityGovernor::stageName(Stage stage)
+{
+  switch (stage) {
+  case STAGE_RENDER:
+    return "render";
+  case STAGE_LINK:
+    return "link";
+  case STAGE_FORWARD:
+    return "forward";
+  default:
+    return "present";
+  }
+}
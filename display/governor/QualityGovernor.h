@@ -0,0 +1,153 @@
+/* =======================================================================================
+   This file is released as part of TCP Display Wall module for TCP Bridged
+   Display Wall module for OSPray
+
+   https://github.com/TACC/tcp-display-wall
+
+   Copyright 2017-2018 Texas Advanced Computing Center, The University of Texas
+   at Austin All rights reserved.
+
+   Licensed under the BSD 3-Clause License, (the "License"); you may not use
+   this file except in compliance with the License. A copy of the License is
+   included with this software in the file LICENSE. If your copy does not
+   contain the License, you may obtain a copy of the License at:
+
+       http://opensource.org/licenses/BSD-3-Clause
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+   License for the specific language governing permissions and limitations under
+   limitations under the License.
+
+   TCP Bridged Display Wall funded in part by an Intel Visualization Center of
+   Excellence award
+   =======================================================================================
+   @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
+ */
+#pragma once
+
+#include <common/networking/Compression.h>
+#include <display/glDisplay/WallConfig.h>
+
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace ospray {
+  namespace dw {
+    namespace display {
+
+      /*! knobs the governor turns, a frame is rendered with one set */
+      struct QualitySettings
+      {
+        int scaleLevel{0};
+        // Samples per pixel the renderer is capped at, 0 leaves it alone
+        int samples{0};
+        // Farm compresses the tiles with the codec of the build
+        bool compress{false};
+
+        int scale() const
+        {
+          return 1 << scaleLevel;
+        }
+
+        bool operator==(const QualitySettings &other) const
+        {
+          return scaleLevel == other.scaleLevel && samples == other.samples &&
+                 compress == other.compress;
+        }
+      };
+
+      /*! where the time of a finished frame went, in ms */
+      struct FrameMeasurements
+      {
+        int32 frame{0};
+        bool dropped{false};
+        QualitySettings settings;
+        // From the request to the FrameEnd, counted once the frame
+        // before it was done
+        double frameTime{0.0};
+        // Farm master, beginning to end of its RenderFrame
+        double renderTime{0.0};
+        // Bulk channel bytes of the frame and as the tiles were rendered.
+        // linkTime is how long they took to arrive, measure replaces it
+        // with their time at the best throughput seen
+        uint64 bytes{0};
+        uint64 rawBytes{0};
+        double linkTime{0.0};
+        // Head node, cropping and batching the tiles
+        double forwardTime{0.0};
+        // Head node, waiting for the panels to show an earlier frame
+        double presentTime{0.0};
+        // Like frameTime, up to the last tile of the region of interest
+        // forwarded. 0 without one
+        double focusTime{0.0};
+      };
+
+      /*! Display head, closed loop over the frame time. Every frame is
+          measured and the slowest stage decides which knob moves: the
+          codec for the link, samples then scale for rendering. Knobs come
+          back in the opposite order once there is room. Only frames
+          rendered with the current settings count, a few of them before
+          the next move.
+
+          Scale and samples only drop while interacting, frames without
+          commits before them are rendered at full quality. With
+          DW_GOVERNOR_LOG every frame, what it measured and what was
+          decided go to that file as CSV */
+      struct QualityGovernor
+      {
+        QualityGovernor();
+
+        /*! knobs the governor may turn, from the device parameters */
+        void configure(float targetFrameTime,
+                       bool scaleKnob,
+                       bool samplesKnob,
+                       bool codecKnob);
+
+        /*! settings for the next frame, maxSamples is what the
+            application asked for */
+        QualitySettings decide(bool interacting, int maxSamples);
+        void measure(const FrameMeasurements &frame);
+
+        /*! mean ms of the frames measured with the current settings */
+        double frameTime();
+        const QualitySettings &current() const
+        {
+          return settings;
+        }
+
+       protected:
+        enum Stage
+        {
+          STAGE_RENDER,
+          STAGE_LINK,
+          STAGE_FORWARD,
+          STAGE_PRESENT
+        };
+        static Stage slowestStage(const FrameMeasurements &frame);
+        static const char *stageName(Stage stage);
+
+        // Turn one knob, "hold" when there was none to turn
+        const char *adjust(int maxSamples);
+
+        std::mutex mutex;
+        float targetFrameTime{33.f};
+        bool scaleKnob{false};
+        bool samplesKnob{false};
+        bool codecKnob{false};
+
+        QualitySettings settings;
+        // Frames measured with settings, their mean and that of the stages
+        int measured{0};
+        FrameMeasurements mean;
+        // Bytes per ms of the bulk channel, the best frame seen
+        double linkThroughput{0.0};
+
+        std::ofstream log;
+      };
+
+    }  // namespace display
+  }    // namespace dw
+}  // namespace ospray
@@ -30,60 +30,270 @@
 #include <display/fb/DisplayFramebuffer.h>
 #include <display/glDisplay/glDisplay.h>
 #include <mpi/fb/DistributedFrameBuffer.h>
+#include <algorithm>
 #include <future>
 
 static std::atomic<size_t> add;
 
-ospray::dw::display::SetTile::SetTile(ospray::ObjectHandle &handle,
-                                      const ospray::uint64 &size,
-                                      const ospcommon::byte_t *msg)
-    : ospray::dw::SetTile(handle, size, msg)
+ospray::dw::display::SetTile::SetTile(std::shared_ptr<byte_t> block,
+                                      size_t blockSize)
+    : ospray::dw::SetTile(std::move(block), blockSize)
 {
 }
 
 void ospray::dw::display::SetTile::run() {}
 
-void ospray::dw::display::SetTile::sendToWorker(size_t worker,
-                                                void *msg,
-                                                size_t size)
+template <OSPFrameBufferFormat FBType>
+void ospray::dw::display::SetTile::forwardTile(DisplayFramebuffer *dfb,
+                                               TilePixels<FBType> &tile,
+                                               const bool focus)
 {
-  std::shared_ptr<maml::Message> msgsend =
-      std::make_shared<maml::Message>(msg, size);
-  mpi::messaging::sendTo(
-      mpicommon::globalRankFromWorkerRank(worker), fbHandle, msgsend);
+  auto device =
+      std::dynamic_pointer_cast<display::Device>(api::Device::current);
+  // Each screen only gets the pixels it is going to show, below full
+  // scale the ones it upscales from
+  auto wc         = device->wc;
+  auto &batcher   = *dfb->batcher;
+  const int scale = dfb->scale();
+  for (auto &route : wc->getRoutes(tile.coords, scale)) {
+    if (dfb->useRMA) {
+      dfb->putTileRegion(route.rank,
+                         tile,
+                         route.region,
+                         wc->screenPosition(route.rank),
+                         wc->localScreen);
+      continue;
+    }
+    // The crop is the only copy, straight into the outgoing message
+    const size_t bytes =
+        tileRegionSize<FBType>(route.region, tile.depth != nullptr);
+    writeTileRegion(tile,
+                    route.region,
+                    dfb->frame(),
+                    scale,
+                    batcher.reserve(route.rank, bytes));
+    batcher.commit(route.rank, bytes);
+    if (focus)
+      batcher.flush(route.rank);
+  }
 }
 
-void ospray::dw::display::SetTile::runOnMaster()
+void ospray::dw::display::SetTile::forwardUnchanged(DisplayFramebuffer *dfb,
+                                                    const bool focus)
 {
+  // With RMA the single buffer of the display ranks still has the pixels
+  if (dfb->useRMA)
+    return;
   auto device =
       std::dynamic_pointer_cast<display::Device>(api::Device::current);
+  auto &batcher   = *dfb->batcher;
+  const int scale = dfb->scale();
+  for (auto &route : device->wc->getRoutes(coords, scale)) {
+    writeTileUnchanged(coords,
+                       dfb->frame(),
+                       scale,
+                       batcher.reserve(route.rank, sizeof(TileRegion)));
+    batcher.commit(route.rank, sizeof(TileRegion));
+    if (focus)
+      batcher.flush(route.rank);
+  }
+}
+
+void ospray::dw::display::SetTile::runOnMaster()
+{
+  auto device =
+      std::dynamic_pointer_cast<dw::display::Device>(api::Device::current);
   auto dfb = dynamic_cast<dw::display::DisplayFramebuffer *>(fbHandle.lookup());
-  auto *msg = (ospray::TileMessage *)data;
+  dfb->openFrame(frame);
+  const bool focus = device->inRegionOfInterest(frame, coords, dfb->tileSize);
+  if (isUnchanged()) {
+    // Counts towards the frame everywhere without any pixels
+    dfb->setNumTilesDone(coords);
+    forwardUnchanged(dfb, focus);
+    if (focus)
+      device->regionOfInterestForwarded();
+    dfb->presentAtDeadline();
+    return;
+  }
+  thread_local std::vector<byte_t> scratch;
+  auto *msg = (ospray::TileMessage *)tileMessage(scratch);
 
   if (msg->command & MASTER_WRITE_TILE_I8) {
     auto MT8 = (MasterTileMessage_RGBA_I8 *)msg;
-    display::TilePixels<OSP_FB_RGBA8> tile(MT8->coords, (byte_t *)MT8->color);
+    display::TilePixels<OSP_FB_RGBA8> tile(
+        MT8->coords, (byte_t *)MT8->color, dfb->tileSize);
+    if (msg->command & DW_TILE_DEPTH)
+      tile.depth = (const float *)((byte_t *)MT8->color +
+                                   dfb->tileSize * dfb->tileSize *
+                                       sizeOfType<OSP_FB_RGBA8>());
 
     dfb->accum(&tile);
-    const auto &ranks = device->wc->getRanks(tile.coords);
-    for (auto &w : ranks) {
-      sendToWorker(w, &tile, sizeof(tile));
-    }
+    forwardTile(dfb, tile, focus);
   } else if (msg->command & MASTER_WRITE_TILE_F32) {
     auto MT32 = (MasterTileMessage_RGBA_F32 *)msg;
-    display::TilePixels<OSP_FB_RGBA32F> tile(MT32->coords,
-                                             (byte_t *)MT32->color);
+    display::TilePixels<OSP_FB_RGBA32F> tile(
+        MT32->coords, (byte_t *)MT32->color, dfb->tileSize);
+    if (msg->command & DW_TILE_DEPTH)
+      tile.depth = (const float *)((byte_t *)MT32->color +
+                                   dfb->tileSize * dfb->tileSize *
+                                       sizeOfType<OSP_FB_RGBA32F>());
 
     dfb->accum(&tile);
-    const auto &ranks = device->wc->getRanks(tile.coords);
-    for (auto &w : ranks) {
-      sendToWorker(w, &tile, sizeof(tile));
-    }
+    forwardTile(dfb, tile, focus);
   } else {
     throw std::runtime_error("Got an unexpected message");
   }
+  if (focus)
+    device->regionOfInterestForwarded();
+  dfb->presentAtDeadline();
+}
+
+void ospray::dw::display::FrameEnd::runOnMaster()
+{
+  auto device =
+      std::dynamic_pointer_cast<dw::display::Device>(api::Device::current);
+  auto *dfb = dynamic_cast<display::DisplayFramebuffer *>(fbHandle.lookup());
+  // A frame without visible tiles only shows up here
+  dfb->openFrame(frame);
+  if (dfb->useRMA) {
+    dfb->flushRegions();
+    mpicommon::world.barrier();
+  } else {
+    // Every display rank shows the frame or keeps the previous one, all
+    // of them the same. Past the deadline the record went out already
+    dfb->presentFrame(frame, !dropped);
+  }
+  dfb->endFrame(inf);
+
+#ifdef DW_MEASURE_TIMES
+  auto &batcher = *dfb->batcher;
+  std::cout << "[Head] Frame " << frame << (dropped ? " dropped" : "")
+            << " scale : 1/" << dfb->scale()
+            << " frame time : " << device->frameTime() << "ms"
+            << " messages : " << batcher.numMessages
+            << " regions : " << batcher.numRegions
+            << " bytes : " << batcher.numBytes << std::endl;
+  std::cout << "[Head] Credit stalls (ms) :";
+  for (auto &stall : batcher.stallTime)
+    std::cout << " " << stall * 1000.0;
+  std::cout << " slowest rank : " << batcher.slowestRank() << std::endl;
+  std::cout << "[Head] Preview downsample : " << dfb->downsampleStats.gbs()
+            << "GB/s" << std::endl;
+  dfb->downsampleStats.reset();
+  auto &copies = mpicommon::copyStats();
+  std::cout << "[Head] Frame copies : " << copies.copies
+            << " bytes : " << copies.bytes << std::endl;
+  copies.reset();
+  auto &pool = mpicommon::poolStats();
+  std::cout << "[Head] Buffer pool allocations : " << pool.allocations
+            << " thread hits : " << pool.threadHits
+            << " shared hits : " << pool.sharedHits
+            << " overflows : " << pool.overflows << " slabs : " << pool.slabs
+            << " (" << (pool.slabBytes >> 20) << "MB)"
+            << " in use : " << (pool.bytesInUse >> 10) << "KB" << std::endl;
+  pool.reset();
+  auto latency = device->takeControlLatency();
+  if (!latency.empty()) {
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&](double p) {
+      return latency[size_t(p * (latency.size() - 1))];
+    };
+    std::cout << "[Head] Control latency (ms) p50 : " << percentile(0.5)
+              << " p90 : " << percentile(0.9)
+              << " p99 : " << percentile(0.99)
+              << " max : " << latency.back() << " commands : " << latency.size()
+              << std::endl;
+  }
+  // Includes this frame only once it is finished below
+  auto frames = device->takeFrameLatency();
+  for (auto *samples : {&frames.focus, &frames.frame}) {
+    if (samples->empty())
+      continue;
+    std::sort(samples->begin(), samples->end());
+    std::cout << "[Head] " << (samples == &frames.focus ? "Region" : "Frame")
+              << " latency (ms) p50 : " << (*samples)[(samples->size() - 1) / 2]
+              << " p90 : " << (*samples)[size_t(0.9 * (samples->size() - 1))]
+              << " max : " << samples->back() << " frames : " << samples->size()
+              << std::endl;
+  }
+  batcher.numMessages = batcher.numRegions = batcher.numBytes = 0;
+  std::fill(batcher.stallTime.begin(), batcher.stallTime.end(), 0.0);
+#endif
+
+  if (dfb->useRMA)
+    mpicommon::world.barrier();
+  device->frameFinished(frame, dropped, renderTime, dfb->takePresentWait());
+}
+
+ospray::dw::display::SetTileMask::SetTileMask(
+    ospray::ObjectHandle &handle,
+    const ospcommon::vec2i &numTiles,
+    const std::vector<byte_t> &mask)
+    : dw::SetTileMask(handle, numTiles, mask)
+{
+}
+
+void ospray::dw::display::SetTileMask::run()
+{
+  runOnMaster();
+}
+
+void ospray::dw::display::SetTileMask::runOnMaster()
+{
+  auto *dfb = dynamic_cast<display::DisplayFramebuffer *>(fbHandle.lookup());
+  assert(dfb);
+  dfb->setTileMask(numTiles, mask);
+}
+
+ospray::dw::display::SetTileSize::SetTileSize(const int tileSize)
+    : tileSize(tileSize)
+{
+}
+
+void ospray::dw::display::SetTileSize::run()
+{
+  auto wc =
+      std::dynamic_pointer_cast<display::Device>(api::Device::current)->wc;
+  wc->setTileSize(tileSize);
+}
+
+void ospray::dw::display::SetTileSize::runOnMaster()
+{
+  run();
+}
+
+void ospray::dw::display::SetTileSize::serialize(
+    networking::WriteStream &b) const
+{
+  b << (int32)tileSize;
+}
+
+void ospray::dw::display::SetTileSize::deserialize(networking::ReadStream &b)
+{
+  int32 size;
+  b >> size;
+  tileSize = size;
+}
+
+ospray::dw::display::SetRegionOfInterest::SetRegionOfInterest(
+    ospray::ObjectHandle &handle, const RegionOfInterest &region)
+    : dw::SetRegionOfInterest(handle, region)
+{
+}
+
+void ospray::dw::display::SetRegionOfInterest::run() {}
+
+void ospray::dw::display::SetRegionOfInterest::runOnMaster() {}
+
+ospray::dw::display::SetTileCodec::SetTileCodec(const uint32 codec)
+    : dw::SetTileCodec(codec)
+{
 }
 
+void ospray::dw::display::SetTileCodec::run() {}
+
+void ospray::dw::display::SetTileCodec::runOnMaster() {}
+
 ospray::dw::display::CreateFrameBuffer::CreateFrameBuffer(
     ospray::ObjectHandle handle,
     ospcommon::vec2i dimensions,
@@ -116,7 +326,8 @@ void ospray::dw::display::CreateFrameBuffer::run()
         vec2i(0),
         vec2f(float(dimensions.x) / wc->completeScreeen.x,
               float(dimensions.y) / wc->completeScreeen.y),
-        wc->completeScreeen);
+        wc->completeScreeen,
+        wc->tileSize);
   } else {
     fb = new DisplayFramebuffer(handle,
                                 wc->localScreen,
@@ -126,7 +337,8 @@ void ospray::dw::display::CreateFrameBuffer::run()
                                 hasVarianceBuffer,
                                 wc->localPosition,
                                 vec2f(1.f),
-                                wc->completeScreeen);
+                                wc->completeScreeen,
+                                wc->tileSize);
   }
   handle.assign(fb);
 }
@@ -142,30 +354,69 @@ void ospray::dw::display::registerOSPWorkItems(
   mpi::work::registerOSPWorkItems(registry);
   // Register common work
   mpi::work::registerWorkUnit<dw::display::SetTile>(registry);
+  mpi::work::registerWorkUnit<dw::display::FrameEnd>(registry);
   // Create a different buffer (instead of writing the buffer just forward)
   mpi::work::registerWorkUnit<dw::display::CreateFrameBuffer>(registry);
+  mpi::work::registerWorkUnit<dw::display::SetTileMask>(registry);
+  mpi::work::registerWorkUnit<dw::display::SetTileSize>(registry);
   // Local Definitions
   mpi::work::registerWorkUnit<dw::display::RenderFrame>(registry);
 }
 
 ospray::dw::display::RenderFrame::RenderFrame(OSPFrameBuffer fb,
                                               OSPRenderer renderer,
-                                              ospray::uint32 channels)
-    : mpi::work::RenderFrame(fb, renderer, channels)
+                                              ospray::uint32 channels,
+                                              const int32 frame,
+                                              const int scale,
+                                              const FrameCamera &camera)
+    : mpi::work::RenderFrame(fb, renderer, channels),
+      frame(frame),
+      scale(scale),
+      camera(camera)
+{
+}
+
+void ospray::dw::display::RenderFrame::serialize(
+    networking::WriteStream &b) const
+{
+  mpi::work::RenderFrame::serialize(b);
+  b << frame << (int32)scale;
+  b << camera.pos << camera.dir << camera.up << camera.fovy << camera.aspect
+    << (int32)camera.valid;
+}
+
+void ospray::dw::display::RenderFrame::deserialize(networking::ReadStream &b)
 {
+  mpi::work::RenderFrame::deserialize(b);
+  int32 s, valid;
+  b >> frame >> s;
+  scale = s;
+  b >> camera.pos >> camera.dir >> camera.up >> camera.fovy >> camera.aspect >>
+      valid;
+  camera.valid = valid;
 }
 
 void ospray::dw::display::RenderFrame::run()
 {
   auto *dfb = dynamic_cast<display::DisplayFramebuffer *>(fbHandle.lookup());
+  if (dfb->useRMA) {
+    // The head puts the tiles in place, the barrier says they are all there
+    mpicommon::world.barrier();
+    dfb->syncRegions();
+    byte_t *color = (byte_t *)dfb->mapColorBuffer();
+    dw::glDisplay::loadFrame(color, dfb->size);
+    dfb->unmap(color);
+    // The window is overwritten by the next frame only once this one is shown
+    mpicommon::world.barrier();
+    return;
+  }
+  // Presented by the frame buffer thread, only wait for the present record
+  // of the head here
+  dfb->setFrameScale(frame, scale);
+  dfb->setFrameCamera(frame, camera);
   dfb->beginFrame();
   dfb->waitUntilFrameDone();
   dfb->endFrame(inf);
-  byte_t *color = (byte_t *)dfb->mapColorBuffer();
-  mpicommon::worker.barrier();
-  dw::glDisplay::loadFrame(color, dfb->size);
-  mpicommon::world.barrier();
-  dfb->unmap(color);
 }
 
 void ospray::dw::display::RenderFrame::runOnMaster()
@@ -173,44 +424,8 @@ void ospray::dw::display::RenderFrame::runOnMaster()
   auto device =
       std::dynamic_pointer_cast<dw::display::Device>(api::Device::current);
   assert(device);
-//  std::chrono::high_resolution_clock::time_point tstart_frame =
-//    std::chrono::high_resolution_clock::now();
-  auto *dfb = dynamic_cast<display::DisplayFramebuffer *>(fbHandle.lookup());
-  dfb->beginFrame();
-//  std::chrono::high_resolution_clock::time_point tstart_master_frame =
-//    std::chrono::high_resolution_clock::now();
-  while (!dfb->isFrameReady()) {
-    auto work = device->readWork();
-    auto tag  = typeIdOf(work);
-    if (tag != typeIdOf<dw::display::SetTile>())
-      throw std::runtime_error("Somthing went wrong it can only be a tile");
-    work->runOnMaster();
-  }
-//  std::chrono::high_resolution_clock::time_point tend_master_frame =
-//    std::chrono::high_resolution_clock::now();
-  dfb->endFrame(inf);
-
-
-
-  mpicommon::world.barrier();
-//  std::chrono::high_resolution_clock::time_point tend_frame =
-//    std::chrono::high_resolution_clock::now();
-//
-//  auto frame_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-//    tend_frame - tstart_master_frame)
-//    .count();
-//  auto frame_time_seconds = std::chrono::duration_cast<std::chrono::seconds>(
-//    tend_frame - tstart_master_frame)
-//    .count();
-//
-//  auto frame_master_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-//    tend_master_frame - tstart_frame)
-//    .count();
-//  auto frame_master_time_seconds = std::chrono::duration_cast<std::chrono::seconds>(
-//    tend_master_frame - tstart_frame)
-//    .count();
-//  std::cout << "Time frame : " << frame_time << "ms ("
-//            << frame_time_seconds << "s)" << " " << "Time master frame : " << frame_master_time << "ms ("
-//                                                    << frame_master_time_seconds << "s)"
-//            << std::endl;
+  // Tiles are run by the device receive thread as they come, only keep
+  // the farm at most DW_FRAME_WINDOW frames ahead of their FrameEnd
+  const int32 frame = ++device->framesRequested;
+  device->waitForFrame(frame - device->frameWindow + 1);
 }
@@ -28,6 +28,7 @@
 #pragma once
 
 #include <common/work/DWwork.h>
+#include <display/fb/DisplayFramebuffer.h>
 
 namespace ospray {
   namespace dw {
@@ -37,10 +38,65 @@ namespace ospray {
       struct SetTile : public dw::SetTile
       {
         SetTile() = default;
-        SetTile(ospray::ObjectHandle &handle,
-                const uint64 &size,
-                const byte_t *msg);
-        void sendToWorker(size_t worker, void *msg, size_t size);
+        SetTile(std::shared_ptr<byte_t> block, size_t blockSize);
+        void run() override;
+        void runOnMaster() override;
+
+       protected:
+        // Batches with a tile of the region of interest go out right away
+        template <OSPFrameBufferFormat FBType>
+        void forwardTile(DisplayFramebuffer *dfb,
+                         TilePixels<FBType> &tile,
+                         const bool focus);
+        void forwardUnchanged(DisplayFramebuffer *dfb, const bool focus);
+      };
+
+      struct FrameEnd : public dw::FrameEnd
+      {
+        FrameEnd() = default;
+        void runOnMaster() override;
+      };
+
+      struct SetTileMask : public dw::SetTileMask
+      {
+        SetTileMask() = default;
+        SetTileMask(ospray::ObjectHandle &handle,
+                    const vec2i &numTiles,
+                    const std::vector<byte_t> &mask);
+        void run() override;
+        void runOnMaster() override;
+      };
+
+      /*! tile size of the farm, from its hello. Sent to the display ranks
+          before any frame buffer is created */
+      struct SetTileSize : public mpi::work::Work
+      {
+        SetTileSize() = default;
+        SetTileSize(const int tileSize);
+        void run() override;
+        void runOnMaster() override;
+        void serialize(networking::WriteStream &b) const;
+        void deserialize(networking::ReadStream &b) override;
+
+        int tileSize{TILE_SIZE};
+      };
+
+      /*! farm only, the head checks the tiles against the region of
+          interest of their frame */
+      struct SetRegionOfInterest : public dw::SetRegionOfInterest
+      {
+        SetRegionOfInterest() = default;
+        SetRegionOfInterest(ospray::ObjectHandle &handle,
+                            const RegionOfInterest &region);
+        void run() override;
+        void runOnMaster() override;
+      };
+
+      /*! farm only, the tiles say their codec */
+      struct SetTileCodec : public dw::SetTileCodec
+      {
+        SetTileCodec() = default;
+        SetTileCodec(const uint32 codec);
         void run() override;
         void runOnMaster() override;
       };
@@ -56,12 +112,27 @@ namespace ospray {
         void runOnMaster() override;
       };
 
+      /*! frame and the scale the farm renders it at, the display ranks
+          wait for the tiles of that scale */
       struct RenderFrame : public mpi::work::RenderFrame
       {
         RenderFrame() = default;
-        RenderFrame(OSPFrameBuffer fb, OSPRenderer renderer, uint32 channels);
+        RenderFrame(OSPFrameBuffer fb,
+                    OSPRenderer renderer,
+                    uint32 channels,
+                    const int32 frame,
+                    const int scale,
+                    const FrameCamera &camera = FrameCamera());
         void run() override;
         void runOnMaster() override;
+        void serialize(networking::WriteStream &b) const;
+        void deserialize(networking::ReadStream &b) override;
+
+        int32 frame{0};
+        int scale{1};
+        // DW_REPROJECT, the display ranks show the last frame through it
+        // until the tiles of this one arrive
+        FrameCamera camera;
       };
 
       void registerOSPWorkItems(mpi::work::WorkTypeRegistry &registry);
@@ -32,8 +32,14 @@
 
 #include <future>
 #include "work/FarmWork.h"
+#include "fb/FarmFramebuffer.h"
 
-ospray::dw::farm::Device::~Device() {}
+ospray::dw::farm::Device::~Device()
+{
+  stopForwarding();
+  if (relayThread.joinable())
+    relayThread.join();
+}
 
 ospray::mpi::work::WorkTypeRegistry &ospray::dw::farm::Device::getWorkRegistry()
 {
@@ -93,6 +99,10 @@ void ospray::dw::farm::Device::commit()
   if (!initialized)
     initializeDevice();
 
+  // Read on every rank, the DFB tile ownership must match across the farm
+  masterIsAWorker =
+      utility::getEnvVar<int>("DW_MASTER_IS_WORKER").value_or(0);
+
   if (mpicommon::IamAWorker())
     ospray::mpi::runWorker(workRegistry);
 
@@ -105,12 +115,27 @@ void ospray::dw::farm::Device::commit()
     try {
       tcpFabric =
           make_unique<mpicommon::TCPFabric>(DW_HOSTNAME, DW_HOSTPORT, false);
-      tcpreadStream  = make_unique<networking::BufferedReadStream>(*tcpFabric);
-      tcpwriteStream = make_unique<networking::BufferedWriteStream>(*tcpFabric);
-    } catch (std::exception ex) {
-      std::cerr << "Unable to connect to display wall at " << DW_HOSTNAME << ":"
-                << DW_HOSTPORT << std::endl;
+      bulkFabric = make_unique<mpicommon::TCPFabric>(
+          DW_HOSTNAME, DW_HOSTPORT + 1, false);
+      tcpreadStream = make_unique<networking::BufferedReadStream>(*tcpFabric);
+      tcpwriteStream =
+          make_unique<networking::BufferedWriteStream>(*bulkFabric);
+      // The tile size is fixed by the OSPRay build of the farm
+      mpicommon::Hello hello;
+      hello.tileSize = TILE_SIZE;
+      tcpFabric->sendFrame(mpicommon::FRAME_HELLO, &hello, sizeof(hello));
+    } catch (const std::exception &e) {
+      // Nothing works without both channels
+      throw std::runtime_error("Unable to connect to display wall at " +
+                               DW_HOSTNAME + ":" +
+                               std::to_string(DW_HOSTPORT) + "-" +
+                               std::to_string(DW_HOSTPORT + 1) + " : " +
+                               e.what());
     }
+
+    tcp_initialized = true;
+    relayThread     = std::thread([&] { relayLoop(); });
+    forwardThread   = std::thread([&] { forwardLoop(); });
   }
 
   auto OSPRAY_DYNAMIC_LOADBALANCER =
@@ -125,6 +150,11 @@ void ospray::dw::farm::Device::commit()
   auto preAllocatedTiles =
       OSPRAY_PREALLOCATED_TILES.value_or(getParam<int>("preAllocatedTiles", 4));
 
+  // The dynamic load balancer needs the master as its scheduler
+  if (masterIsAWorker && useDynamicLoadBalancer)
+    throw std::runtime_error(
+        "DW_MASTER_IS_WORKER needs the static load balancer");
+
   mpi::work::SetLoadBalancer slbWork(
       ObjectHandle(), useDynamicLoadBalancer, preAllocatedTiles);
   processWork(slbWork);
@@ -132,13 +162,137 @@ void ospray::dw::farm::Device::commit()
   bool exit = false;
 
   while (!exit) {
-    auto work = ospray::mpi::readWork(workRegistry, *tcpreadStream);
+    auto work = incomingWork.pop();
     auto tag  = typeIdOf(work);
 
     exit = (tag == typeIdOf<mpi::work::CommandFinalize>());
-    processWork(*work, true);
+    if (masterIsAWorker && runOnMasterAsWorker(*work)) {
+      // The master has the objects too, runOnMaster would repeat run
+      writeStream->write(&tag, sizeof(tag));
+      work->serialize(*writeStream);
+      writeStream->flush();
+      work->run();
+    } else {
+      processWork(*work, true);
+    }
     postStatusMsg(OSPRAY_MPI_VERBOSE_LEVEL) << "Finished " << typeString(work);
   }
+
+  // The tiles and frame ends still queued reach the display before the
+  // farm goes away, the finalize behind them stops its receive thread
+  forwardWorkDisplayWall(make_unique<mpi::work::CommandFinalize>());
+  stopForwarding();
+  relayThread.join();
+}
+
+void ospray::dw::farm::Device::stopForwarding()
+{
+  if (!forwardThread.joinable())
+    return;
+  outgoingWork.push(nullptr);
+  forwardThread.join();
+}
+
+void ospray::dw::farm::Device::relayLoop()
+{
+  bool exit  = false;
+  uint64 seq = 0;
+  while (!exit) {
+    auto work = ospray::mpi::readWork(workRegistry, *tcpreadStream);
+    exit = (typeIdOf(work) == typeIdOf<mpi::work::CommandFinalize>());
+    // Acknowledged on receipt, the display head measures the latency of
+    // the control channel, not how long the commit loop takes to run the
+    // command. Its control thread stops at the ack of the finalize
+    tcpFabric->sendAck(seq++);
+    incomingWork.push(std::move(work));
+  }
+}
+
+void ospray::dw::farm::Device::forwardLoop()
+{
+  int32 droppingFrame = 0;
+  while (true) {
+    // Queued tiles closest to the region of interest go first, a frame
+    // end stays behind the tiles of its frame, and so does the empty
+    // work that stops the thread
+    auto work = outgoingWork.pop(
+        [](const std::unique_ptr<mpi::work::Work> &queued) {
+          auto *tile = dynamic_cast<SetTile *>(queued.get());
+          return tile ? tile->priority : -1;
+        },
+        64);
+    if (!work)
+      break;
+    auto *tile = dynamic_cast<SetTile *>(work.get());
+    // Latest frame wins, a late frame would only delay the newer one
+    if (tile && tile->frameID() < latestFrame) {
+      droppingFrame = tile->frameID();
+      tilesDropped++;
+      auto *dfb = dynamic_cast<farm::DistributedFrameBuffer *>(
+          tile->frameBuffer().lookup());
+      if (dfb)
+        dfb->tileDropped(*tile);
+      continue;
+    }
+
+    auto *end = dynamic_cast<FrameEnd *>(work.get());
+    if (end) {
+      end->dropped = (end->frame == droppingFrame);
+      if (end->dropped)
+        framesDropped++;
+      else
+        framesSent++;
+#ifdef DW_MEASURE_TIMES
+      std::cout << "[Farm] Frame " << end->frame
+                << (end->dropped ? " dropped" : " sent")
+                << " queue : " << queueDepth() << " sent : " << framesSent
+                << " dropped : " << framesDropped
+                << " tiles dropped : " << tilesDropped
+                << " tiles unchanged : " << tilesUnchanged << std::endl;
+      auto &pool = mpicommon::poolStats();
+      std::cout << "[Farm] Buffer pool allocations : " << pool.allocations
+                << " thread hits : " << pool.threadHits
+                << " overflows : " << pool.overflows
+                << " slabs : " << pool.slabs << " ("
+                << (pool.slabBytes >> 20) << "MB)" << std::endl;
+      pool.reset();
+      auto &framing = bulkFabric->tileStats;
+      if (framing.tiles) {
+        std::cout << "[Farm] Tile framing bytes : "
+                  << framing.framingBytes / framing.tiles << " per tile ("
+                  << 100.0 * framing.framingBytes / framing.payloadBytes
+                  << "% of payload)" << std::endl;
+      }
+      framing = mpicommon::TCPFabric::TileStats();
+#endif
+    }
+
+    // Tiles skip the work registry, the fabric does not compress them so
+    // the ones not compressed by their owner are compressed here
+    if (tile) {
+      tile->compress(
+          mpicommon::Codec(farm::DistributedFrameBuffer::tileCodec.load()));
+      auto *dfb = dynamic_cast<farm::DistributedFrameBuffer *>(
+          tile->frameBuffer().lookup());
+      if (dfb && dfb->tileUnchanged(*tile)) {
+        tile->markUnchanged();
+        tilesUnchanged++;
+      }
+      bulkFabric->sendTile(tile->tileFrame(), tile->payload());
+      continue;
+    }
+    sendWorkDisplayWall(*work, true);
+  }
+}
+
+bool ospray::dw::farm::Device::runOnMasterAsWorker(mpi::work::Work &work)
+{
+  // Frame buffers, rendering and shutdown have their own master code path
+  auto tag = typeIdOf(work);
+  return tag != typeIdOf<farm::CreateFrameBuffer>() &&
+         tag != typeIdOf<farm::RenderFrame>() &&
+         tag != typeIdOf<mpi::work::SetLoadBalancer>() &&
+         tag != typeIdOf<mpi::work::CommandFinalize>();
 }
 
 void ospray::dw::farm::Device::sendWorkDisplayWall(mpi::work::Work &work,
@@ -150,5 +304,21 @@ void ospray::dw::farm::Device::sendWorkDisplayWall(mpi::work::Work &work,
   tcpwriteStream->flush();
 }
 
+void ospray::dw::farm::Device::forwardWorkDisplayWall(
+    std::unique_ptr<mpi::work::Work> work)
+{
+  outgoingWork.push(std::move(work));
+}
+
+void ospray::dw::farm::Device::frameRendered(ObjectHandle &handle,
+                                             const int32 frame,
+                                             const float renderTime)
+{
+  latestFrame    = frame;
+  auto end       = make_unique<FrameEnd>(handle, frame);
+  end->renderTime = renderTime;
+  outgoingWork.push(std::move(end));
+}
+
 OSP_REGISTER_DEVICE(ospray::dw::farm::Device, dwfarm);
 OSP_REGISTER_DEVICE(ospray::dw::farm::Device, farm);
\ No newline at end of file
@@ -29,8 +29,12 @@
 #define OSPRAY_FARM_DEVICE_H
 
 #include <common/networking/TCPFabric.h>
+#include <common/work/WorkQueue.h>
 #include <mpi/MPIOffloadDevice.h>
 
+#include <atomic>
+#include <thread>
+
 namespace ospray {
   namespace dw {
     namespace farm {
@@ -42,14 +46,54 @@ namespace ospray {
         void commit() override;
         void sendWorkDisplayWall(mpi::work::Work &work,
                                  bool flushWriteStream = false);
+        void forwardWorkDisplayWall(std::unique_ptr<mpi::work::Work> work);
+        /*! queue the end of frame behind its tiles, tiles of older frames
+            still queued are dropped from now on. renderTime in ms */
+        void frameRendered(ObjectHandle &handle,
+                           const int32 frame,
+                           const float renderTime);
         mpi::work::WorkTypeRegistry &getWorkRegistry();
 
+        // The master also owns tiles and renders (DW_MASTER_IS_WORKER)
+        bool masterIsAWorker{false};
+
+        // Forwarding statistics, frames whose tiles were skipped because a
+        // newer frame was ready count as dropped
+        std::atomic<size_t> framesSent{0};
+        std::atomic<size_t> framesDropped{0};
+        std::atomic<size_t> tilesDropped{0};
+        // Tiles sent without pixels, the display wall already had them
+        std::atomic<size_t> tilesUnchanged{0};
+        size_t queueDepth()
+        {
+          return outgoingWork.size();
+        }
+
        protected:
         void initializeDevice() override;
-        std::unique_ptr<networking::Fabric> tcpFabric{nullptr};
+        void relayLoop();
+        void forwardLoop();
+        /*! send what is queued for the display and join the forward thread */
+        void stopForwarding();
+        bool runOnMasterAsWorker(mpi::work::Work &work);
+        // Control channel, commands from the display head and their
+        // acknowledgements. Tiles and frame ends go on the bulk channel so
+        // commands never queue behind pixels
+        std::unique_ptr<mpicommon::TCPFabric> tcpFabric{nullptr};
+        std::unique_ptr<mpicommon::TCPFabric> bulkFabric{nullptr};
         std::unique_ptr<networking::ReadStream> tcpreadStream{nullptr};
         std::unique_ptr<networking::WriteStream> tcpwriteStream{nullptr};
         bool tcp_initialized{false};
+
+        // Communication threads, TCP relay (display -> farm) and tile
+        // forwarding (farm -> display). The relay stops after it passed on
+        // CommandFinalize, the forward thread on an empty work
+        std::thread relayThread;
+        std::thread forwardThread;
+        WorkQueue<std::unique_ptr<mpi::work::Work>> incomingWork;
+        WorkQueue<std::unique_ptr<mpi::work::Work>> outgoingWork;
+        // Newest frame completely rendered
+        std::atomic<int32> latestFrame{0};
       };
 
     }  // namespace farm
@@ -26,10 +26,9 @@
    @author Joao Barbosa <jbarbosa@tacc.utexas.edu>
  */
 #include "FarmFramebuffer.h"
-#include <future>
 #include <common/work/DWwork.h>
-
-static std::atomic<int> count{0};
+#include <mpi/common/Messaging.h>
+#include "ospcommon/utility/getEnvVar.h"
 
 ospray::dw::farm::DistributedFrameBuffer::DistributedFrameBuffer(
     const ospcommon::vec2i &numPixels,
@@ -39,28 +38,258 @@ ospray::dw::farm::DistributedFrameBuffer::DistributedFrameBuffer(
     bool hasAccumBuffer,
     bool hasVarianceBuffer,
     bool masterIsAWorker)
+    // Owners send their final tiles themselves, the base frame buffer
+    // only tells the master which tiles are done
     : ospray::DistributedFrameBuffer(numPixels,
                                      myHandle,
-                                     format,
+                                     OSP_FB_NONE,
                                      hasDepthBuffer,
                                      hasAccumBuffer,
                                      hasVarianceBuffer,
-                                     masterIsAWorker)
+                                     masterIsAWorker),
+      tileFormat(format)
 {
-
+  const vec2i numTiles = getNumTiles();
+  sentHash.assign(numTiles.x * numTiles.y, 0);
+  sentFrame.assign(numTiles.x * numTiles.y, 0);
+  errorThreshold =
+      utility::getEnvVar<float>("DW_TILE_ERROR_THRESHOLD").value_or(0.f);
+  refreshFrames = utility::getEnvVar<int>("DW_TILE_REFRESH").value_or(30);
 }
 ospray::dw::farm::DistributedFrameBuffer::~DistributedFrameBuffer() {}
 
 void ospray::dw::farm::DistributedFrameBuffer::scheduleProcessing(
     const std::shared_ptr<mpicommon::Message> &message)
 {
-  std::future<void> t = std::async([&] {
-        SetTile tile(myId, message->size, message->data);
-        auto device = std::dynamic_pointer_cast<ospray::dw::farm::Device>(
-                ospray::api::Device::current);
-        assert(device);
-
-        device->sendWorkDisplayWall(tile, true);
-  });
+  auto *msg = (ospray::TileMessage *)message->data;
+  if (msg->command == DW_WRITE_COMPRESSED_TILE) {
+    auto *header = (CompressedTileMessage *)message->data;
+    forwardTile(message->data + sizeof(CompressedTileMessage),
+                header->size,
+                header->tileCommand,
+                header->coords,
+                header->error,
+                header->frame,
+                mpicommon::Codec(header->codec),
+                header->rawSize);
+    return;
+  }
   ospray::DistributedFrameBuffer::scheduleProcessing(message);
-}
\ No newline at end of file
+}
+
+void ospray::dw::farm::DistributedFrameBuffer::tileIsCompleted(
+    ospray::TileData *tile)
+{
+  // Forwarded before the master hears the tile is done, so every tile of a
+  // frame is queued for the display wall when the frame ends
+  forwardCompletedTile(tile);
+  ospray::DistributedFrameBuffer::tileIsCompleted(tile);
+}
+
+std::atomic<ospray::int32>
+    ospray::dw::farm::DistributedFrameBuffer::framesBegun{0};
+std::atomic<uint32_t> ospray::dw::farm::DistributedFrameBuffer::tileCodec{
+    mpicommon::defaultCodec()};
+
+void ospray::dw::farm::DistributedFrameBuffer::beginFrame()
+{
+  // Every tile of the frame before reached the master, no tile is on its
+  // way with the old codec
+  codec = mpicommon::Codec(tileCodec.load());
+  ospray::DistributedFrameBuffer::beginFrame();
+  const int32 previous = currentFrame;
+  currentFrame         = ++framesBegun;
+  if (previous && currentFrame != previous + 1)
+    resyncFrame = currentFrame;
+}
+
+void ospray::dw::farm::DistributedFrameBuffer::forwardCompletedTile(
+    ospray::TileData *tile)
+{
+  if (!tileVisible(tile->begin / TILE_SIZE))
+    return;
+
+  // The base frame buffer has no color format, the owner converts the
+  // final tile the way it would. The messages are too large for the
+  // stack of the tasking threads
+  switch (tileFormat) {
+  case OSP_FB_RGBA8:
+  case OSP_FB_SRGBA: {
+    const bool srgb = tileFormat == OSP_FB_SRGBA;
+    thread_local MasterTileMessage_RGBA_I8 msg;
+    msg.command = MASTER_WRITE_TILE_I8;
+    msg.coords  = tile->begin;
+    msg.error   = tile->error;
+    for (int i = 0; i < TILE_SIZE * TILE_SIZE; i++) {
+      msg.color[i] = packColor(tile->final.r[i], srgb) |
+                     (packColor(tile->final.g[i], srgb) << 8) |
+                     (packColor(tile->final.b[i], srgb) << 16) |
+                     (packColor(tile->final.a[i], false) << 24);
+    }
+    sendFinalTile(tile, (byte_t *)&msg, sizeof(msg));
+  } break;
+  case OSP_FB_RGBA32F: {
+    thread_local MasterTileMessage_RGBA_F32 msg;
+    msg.command = MASTER_WRITE_TILE_F32;
+    msg.coords  = tile->begin;
+    msg.error   = tile->error;
+    for (int i = 0; i < TILE_SIZE * TILE_SIZE; i++) {
+      msg.color[i] = vec4f(tile->final.r[i],
+                           tile->final.g[i],
+                           tile->final.b[i],
+                           tile->final.a[i]);
+    }
+    sendFinalTile(tile, (byte_t *)&msg, sizeof(msg));
+  } break;
+  default:
+    break;
+  }
+}
+
+void ospray::dw::farm::DistributedFrameBuffer::sendFinalTile(
+    ospray::TileData *tile, const byte_t *msg, size_t size)
+{
+  if (!hasDepthBuffer) {
+    sendCompressedTile(msg, size);
+    return;
+  }
+  // Depth goes with the color for the display ranks to reproject
+  thread_local std::vector<byte_t> withDepth;
+  withDepth.resize(size + sizeof(tile->final.z));
+  std::memcpy(withDepth.data(), msg, size);
+  std::memcpy(withDepth.data() + size, tile->final.z, sizeof(tile->final.z));
+  ((ospray::TileMessage *)withDepth.data())->command |= DW_TILE_DEPTH;
+  sendCompressedTile(withDepth.data(), withDepth.size());
+}
+
+void ospray::dw::farm::DistributedFrameBuffer::setTileMask(
+    const std::vector<byte_t> &mask)
+{
+  tileMask = mask;
+}
+
+bool ospray::dw::farm::DistributedFrameBuffer::tileVisible(
+    const vec2i &tile) const
+{
+  if (tileMask.empty())
+    return true;
+  return tileMask[tile.y * getNumTiles().x + tile.x];
+}
+
+void ospray::dw::farm::DistributedFrameBuffer::setRegionOfInterest(
+    const RegionOfInterest &region)
+{
+  regionOfInterest = region;
+}
+
+ospray::int32 ospray::dw::farm::DistributedFrameBuffer::tilePriority(
+    const vec2i &tile) const
+{
+  if (!regionOfInterest.active)
+    return 0;
+  const vec2f lower(tile * TILE_SIZE);
+  return int32(
+      regionOfInterest.distance(box2f(lower, lower + vec2f(TILE_SIZE))));
+}
+
+void ospray::dw::farm::DistributedFrameBuffer::sendCompressedTile(
+    const byte_t *msg, size_t size)
+{
+  // Both tile message formats start with the command and the coords
+  auto *tile = (const MasterTileMessage_RGBA_I8 *)msg;
+
+  // Without a codec the tile message goes as it is
+  thread_local std::vector<byte_t> compressed;
+  const byte_t *payload = msg;
+  size_t payloadSize    = size;
+  if (codec != mpicommon::CODEC_NONE) {
+    compressTileMessage(msg, size, codec, compressed);
+    payload     = compressed.data();
+    payloadSize = compressed.size();
+  }
+
+  if (mpicommon::IamTheMaster()) {
+    forwardTile(payload,
+                payloadSize,
+                tile->command,
+                tile->coords,
+                tile->error,
+                currentFrame,
+                codec,
+                size);
+    return;
+  }
+
+  auto out = std::make_shared<mpicommon::Message>(
+      sizeof(CompressedTileMessage) + payloadSize);
+  CompressedTileMessage header;
+  header.tileCommand = tile->command;
+  header.coords      = tile->coords;
+  header.error       = tile->error;
+  header.frame       = currentFrame;
+  header.codec       = codec;
+  header.rawSize     = size;
+  header.size        = payloadSize;
+  std::memcpy(out->data, &header, sizeof(header));
+  std::memcpy(out->data + sizeof(header), payload, payloadSize);
+  mpi::messaging::sendTo(mpicommon::masterRank(), myId, out);
+}
+
+void ospray::dw::farm::DistributedFrameBuffer::forwardTile(
+    const byte_t *msg,
+    size_t size,
+    const int32 command,
+    const vec2i &coords,
+    const float error,
+    const int32 frame,
+    mpicommon::Codec codec,
+    size_t rawSize)
+{
+  auto device = std::dynamic_pointer_cast<ospray::dw::farm::Device>(
+      ospray::api::Device::current);
+  assert(device);
+  auto tile = make_unique<SetTile>(
+      myId, size, msg, command, coords, codec, rawSize, frame);
+  tile->error    = error;
+  tile->priority = tilePriority(coords / TILE_SIZE);
+  device->forwardWorkDisplayWall(std::move(tile));
+}
+
+bool ospray::dw::farm::DistributedFrameBuffer::tileUnchanged(
+    const SetTile &tile)
+{
+  const vec2i id    = tile.tileCoords() / TILE_SIZE;
+  const int t       = id.y * getNumTiles().x + id.x;
+  const int32 frame = tile.frameID();
+
+  // FNV-1a over 64 bit words, 0 means nothing was sent yet
+  const byte_t *bytes = tile.payload();
+  const size_t size   = tile.payloadSize();
+  uint64 hash         = 14695981039346656037ull;
+  size_t i            = 0;
+  for (; i + sizeof(uint64) <= size; i += sizeof(uint64)) {
+    uint64 word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  for (; i < size; i++)
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  hash |= 1;
+
+  const bool refresh =
+      (refreshFrames > 0 && frame - sentFrame[t] >= refreshFrames) ||
+      sentFrame[t] < resyncFrame;
+  const bool converged = hasVarianceBuffer && errorThreshold > 0.f &&
+                         tile.error < errorThreshold && sentHash[t];
+  if (!refresh && (hash == sentHash[t] || converged))
+    return true;
+  sentHash[t]  = hash;
+  sentFrame[t] = frame;
+  return false;
+}
+
+void ospray::dw::farm::DistributedFrameBuffer::tileDropped(const SetTile &tile)
+{
+  const vec2i id = tile.tileCoords() / TILE_SIZE;
+  sentHash[id.y * getNumTiles().x + id.x] = 0;
+}
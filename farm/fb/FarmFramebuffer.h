@@ -30,11 +30,38 @@
 #include <api/Device.h>
 #include <mpi/fb/DistributedFrameBuffer.h>
 #include "../Device.h"
+#include <common/work/DWwork.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
 namespace ospray {
   namespace dw {
     namespace farm {
 
+      enum
+      {
+        DW_WRITE_COMPRESSED_TILE = 1 << 20
+      };
+
+      /*! final tile compressed by its owner, followed by the compressed
+          MasterTileMessage bytes */
+      struct CompressedTileMessage
+      {
+        int32 command{DW_WRITE_COMPRESSED_TILE};
+        // Command and origin of the tile message before compression
+        int32 tileCommand;
+        vec2i coords;
+        float error;
+        // Frame the owner rendered the tile in, the master may already be
+        // in the next one or not there yet
+        int32 frame;
+        uint32 codec;
+        uint64 rawSize;
+        uint64 size;
+      };
+
       struct DistributedFrameBuffer : public ospray::DistributedFrameBuffer
       {
         DistributedFrameBuffer(const vec2i &numPixels,
@@ -47,6 +74,91 @@ namespace ospray {
         ~DistributedFrameBuffer() override;
         void scheduleProcessing(
             const std::shared_ptr<mpicommon::Message> &message) override;
+        void tileIsCompleted(TileData *tile) override;
+        void beginFrame() override;
+
+        /*! frame being rendered, tiles forwarded to the display wall are
+            stamped with it */
+        int32 frame() const
+        {
+          return currentFrame;
+        }
+
+        void setTileMask(const std::vector<byte_t> &mask);
+        /*! tile is in tile coordinates */
+        bool tileVisible(const vec2i &tile) const;
+
+        /*! forward thread, true when the display wall already shows what
+            tile would send: the same pixels, or pixels converged below
+            DW_TILE_ERROR_THRESHOLD. Only tiles that are sent are
+            remembered, a dropped one is forgotten, and every tile is sent
+            again after DW_TILE_REFRESH frames */
+        bool tileUnchanged(const SetTile &tile);
+        /*! forward thread, tile was dropped. The display wall may not
+            have the pixels sent before it in the buffer it copies from,
+            the next one goes out in full */
+        void tileDropped(const SetTile &tile);
+
+        /*! SetRegionOfInterest, tiles of the next frames are rendered
+            and sent closest to it first */
+        void setRegionOfInterest(const RegionOfInterest &region);
+        /*! pixels from the tile, in tile coordinates, to the region of
+            interest. 0 for every tile without one */
+        int32 tilePriority(const vec2i &tile) const;
+
+        /*! SetTileCodec, the codec of the build unless the display head
+            turned it off */
+        static std::atomic<uint32_t> tileCodec;
+
+       protected:
+        void forwardTile(const byte_t *msg,
+                         size_t size,
+                         const int32 command,
+                         const vec2i &coords,
+                         const float error,
+                         const int32 frame,
+                         mpicommon::Codec codec = mpicommon::CODEC_NONE,
+                         size_t rawSize         = 0);
+        void sendCompressedTile(const byte_t *msg, size_t size);
+        /*! tile message of a completed tile, its depth appended when the
+            frame buffer has a depth buffer */
+        void sendFinalTile(TileData *tile, const byte_t *msg, size_t size);
+        void forwardCompletedTile(TileData *tile);
+        /*! channel of a final tile to 8 bits, with the sRGB curve the
+            display ranks use in linearToSRGB */
+        static inline uint32 packColor(float c, bool srgb)
+        {
+          c = std::min(std::max(c, 0.f), 1.f);
+          if (srgb)
+            c = c <= 0.0031308f ? 12.92f * c
+                                : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+          return uint32(255.9f * c);
+        }
+
+        int32 currentFrame{0};
+        // Frames are numbered across the frame buffers, the display wall
+        // sees one sequence whichever buffer renders at which scale
+        static std::atomic<int32> framesBegun;
+        // A frame of another buffer came in between, the tiles this one
+        // sent before are not what the display wall shows
+        std::atomic<int32> resyncFrame{0};
+
+        // One byte per tile, empty when every tile is visible
+        std::vector<byte_t> tileMask;
+        RegionOfInterest regionOfInterest;
+
+        // Format of the tiles sent to the display wall, the base frame
+        // buffer is OSP_FB_NONE
+        const ColorBufferFormat tileFormat;
+        // Owners compress their final tiles when there is a codec and add
+        // their depth, the codec only changes when a frame begins
+        mpicommon::Codec codec{mpicommon::CODEC_NONE};
+
+        // Hash and frame of the last pixels sent for each tile
+        std::vector<uint64> sentHash;
+        std::vector<int32> sentFrame;
+        float errorThreshold{0.f};
+        int refreshFrames{30};
       };
 
     }  // namespace farm
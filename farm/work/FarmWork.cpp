@@ -27,10 +27,25 @@
  */
 #include "FarmWork.h"
 #include "fb/FarmFramebuffer.h"
+#include <mpi/render/MPILoadBalancer.h>
+#include <ospray/render/LoadBalancer.h>
+#include <ospray/render/Renderer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+static bool masterIsAWorker()
+{
+  auto device = std::dynamic_pointer_cast<ospray::dw::farm::Device>(
+      ospray::api::Device::current);
+  assert(device);
+  return device->masterIsAWorker;
+}
 
 void ospray::dw::farm::CreateFrameBuffer::run()
 {
-  mpi::work::CreateFrameBuffer::run();
+  runOnMaster();
 }
 void ospray::dw::farm::CreateFrameBuffer::runOnMaster()
 {
@@ -47,11 +62,142 @@ void ospray::dw::farm::CreateFrameBuffer::runOnMaster()
                                                    format,
                                                    hasDepthBuffer,
                                                    hasAccumBuffer,
-                                                   hasVarianceBuffer);
+                                                   hasVarianceBuffer,
+                                                   masterIsAWorker());
 
   handle.assign(fb);
 }
 
+void ospray::dw::farm::SetTileMask::run()
+{
+  runOnMaster();
+}
+
+void ospray::dw::farm::SetTileMask::runOnMaster()
+{
+  auto *dfb = dynamic_cast<DistributedFrameBuffer *>(fbHandle.lookup());
+  assert(dfb);
+  if (dfb->getNumTiles() != numTiles)
+    throw std::runtime_error("Tile mask does not match the frame buffer");
+  dfb->setTileMask(mask);
+}
+
+static bool staticLoadBalancer()
+{
+  return dynamic_cast<ospray::mpi::staticLoadBalancer::Slave *>(
+             ospray::TiledLoadBalancer::instance.get()) != nullptr;
+}
+
+void ospray::dw::farm::SetTileCodec::run()
+{
+  runOnMaster();
+}
+
+void ospray::dw::farm::SetTileCodec::runOnMaster()
+{
+  DistributedFrameBuffer::tileCodec = codec;
+}
+
+void ospray::dw::farm::SetRegionOfInterest::run()
+{
+  runOnMaster();
+}
+
+void ospray::dw::farm::SetRegionOfInterest::runOnMaster()
+{
+  auto *dfb = dynamic_cast<DistributedFrameBuffer *>(fbHandle.lookup());
+  assert(dfb);
+  dfb->setRegionOfInterest(region);
+}
+
+void ospray::dw::farm::RenderFrame::run()
+{
+  // The static split is rendered here, with the bezel mask and the region
+  // of interest order. The dynamic load balancer hands out the tiles itself
+  if (masterIsAWorker())
+    renderTiles(mpicommon::world.rank, mpicommon::world.size);
+  else if (staticLoadBalancer())
+    renderTiles(mpicommon::worker.rank, mpicommon::worker.size);
+  else
+    mpi::work::RenderFrame::run();
+}
+
+void ospray::dw::farm::RenderFrame::runOnMaster()
+{
+  const auto start = std::chrono::steady_clock::now();
+  if (masterIsAWorker())
+    renderTiles(mpicommon::world.rank, mpicommon::world.size);
+  else
+    mpi::work::RenderFrame::runOnMaster();
+
+  // Every tile of the frame is queued by now, close it behind them
+  auto device = std::dynamic_pointer_cast<ospray::dw::farm::Device>(
+      ospray::api::Device::current);
+  auto *dfb = dynamic_cast<DistributedFrameBuffer *>(fbHandle.lookup());
+  device->frameRendered(
+      fbHandle,
+      dfb->frame(),
+      std::chrono::duration<float, std::milli>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+}
+
+void ospray::dw::farm::RenderFrame::renderTiles(int rank, int numRanks)
+{
+  auto *dfb      = dynamic_cast<DistributedFrameBuffer *>(fbHandle.lookup());
+  auto *renderer = (Renderer *)rendererHandle.lookup();
+  assert(dfb);
+  assert(renderer);
+
+  dfb->startNewFrame(renderer->errorThreshold);
+  dfb->beginFrame();
+  auto *perFrameData = renderer->beginFrame(dfb);
+
+  const auto fbSize     = dfb->getNumPixels();
+  const int numTiles    = dfb->getTotalTiles();
+  const int numTiles_x  = dfb->getNumTiles().x;
+  int numMyTiles        = numTiles / numRanks;
+  if (rank < numTiles % numRanks)
+    numMyTiles++;
+
+  // Closest to the region of interest first, every task takes the next
+  // tile in that order
+  std::vector<int> order(numMyTiles);
+  std::vector<int32> priority(numTiles);
+  for (int i = 0; i < numMyTiles; i++) {
+    order[i]           = i * numRanks + rank;
+    priority[order[i]] = dfb->tilePriority(
+        vec2i(order[i] % numTiles_x, order[i] / numTiles_x));
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return priority[a] < priority[b];
+  });
+  std::atomic<int> nextTile{0};
+
+  tasking::parallel_for(numMyTiles, [&](int) {
+    const int tileID = order[nextTile++];
+    const vec2i tileId(tileID % numTiles_x, tileID / numTiles_x);
+    const int32 accumID = dfb->accumID(tileId);
+
+    if (dfb->tileError(tileId) <= renderer->errorThreshold)
+      return;
+
+    Tile __aligned(64) tile(tileId, fbSize, accumID);
+    // Tiles behind the bezels still count towards the frame, they are just
+    // not rendered
+    if (dfb->tileVisible(tileId)) {
+      tasking::parallel_for(numJobs(renderer->spp, accumID), [&](int tid) {
+        renderer->renderTile(perFrameData, tile, tid);
+      });
+    }
+    dfb->setTile(tile);
+  });
+
+  dfb->waitUntilFinished();
+  renderer->endFrame(perFrameData, channels);
+  varianceResult = dfb->endFrame(renderer->errorThreshold);
+}
+
 ospray::dw::farm::CreateFrameBuffer::CreateFrameBuffer(
     ospray::ObjectHandle handle,
     ospcommon::vec2i dimensions,
@@ -68,7 +214,13 @@ void ospray::dw::farm::registerOSPWorkItems(
 
   // Register common work
   mpi::work::registerWorkUnit<dw::SetTile>(registry);
+  mpi::work::registerWorkUnit<dw::FrameEnd>(registry);
 
   // Create a different buffer (instead of writing the buffer just forward)
   mpi::work::registerWorkUnit<dw::farm::CreateFrameBuffer>(registry);
+  // Render on the master as well when it is a worker
+  mpi::work::registerWorkUnit<dw::farm::RenderFrame>(registry);
+  mpi::work::registerWorkUnit<dw::farm::SetTileMask>(registry);
+  mpi::work::registerWorkUnit<dw::farm::SetTileCodec>(registry);
+  mpi::work::registerWorkUnit<dw::farm::SetRegionOfInterest>(registry);
 }
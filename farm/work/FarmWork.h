@@ -47,6 +47,37 @@ namespace ospray {
         void runOnMaster() override;
       };
 
+      struct SetTileMask : public dw::SetTileMask
+      {
+        SetTileMask() = default;
+        void run() override;
+        void runOnMaster() override;
+      };
+
+      struct SetTileCodec : public dw::SetTileCodec
+      {
+        SetTileCodec() = default;
+        void run() override;
+        void runOnMaster() override;
+      };
+
+      struct SetRegionOfInterest : public dw::SetRegionOfInterest
+      {
+        SetRegionOfInterest() = default;
+        void run() override;
+        void runOnMaster() override;
+      };
+
+      struct RenderFrame : public mpi::work::RenderFrame
+      {
+        RenderFrame() = default;
+        void run() override;
+        void runOnMaster() override;
+
+       protected:
+        void renderTiles(int rank, int numRanks);
+      };
+
     }  // namespace farm
   }    // namespace dw
 }  // namespace ospray